@@ -0,0 +1,253 @@
+#include <ultimateALPR-SDK-API-PUBLIC.h>
+#include <alpr_utils.h>
+#include <alpr_engine.h>
+#include <alpr_pipeline.h>
+#include <alpr_queue.h>
+#include <alpr_enroll.h>
+#include <alpr_metrics.h>
+#include <opencv2/core.hpp>
+#include <opencv2/videoio.hpp>
+#include <json.hpp> // nlohmann/json
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+/*
+* Bulk enrollment: every photo and video under a folder goes through the recognizer, the confirmed
+* plates are appended to the watchlist (see AlprEnrollmentWriter, already registered plates are skipped).
+*	- photos (jpg, jpeg, png, bmp, ppm, pgm) are decoded with alprDecodeFile by a pool of workers, a plate read
+*		on a photo with at least --min_confidence is confirmed
+*	- videos (mp4, avi, mkv, mov) are decoded by one worker each, a plate is confirmed once read on
+*		--num_repeat frames of the same video, like gen_registered
+* The decoders stay at most --queue images ahead of the engine, which runs on the main thread.
+*/
+
+/*
+* One image for the engine: a decoded photo, or a frame of a video ('frame' empty for the end-of-video marker)
+*/
+struct EnrollItem {
+	size_t source = 0; // index in the file list
+	bool video = false;
+	std::shared_ptr<AlprFile> photo;
+	cv::Mat frame;
+};
+
+static void printUsage(const std::string& message = "");
+
+static std::string extensionOf(const std::string& path)
+{
+	const size_t dot = path.find_last_of('.');
+	std::string extension = (dot == std::string::npos || path.find('/', dot) != std::string::npos) ? "" : path.substr(dot + 1);
+	std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+	return extension;
+}
+
+int main(int argc, char** argv) {
+	if (argc < 2 || strncmp(argv[1], "--", 2) == 0) {
+		printUsage("<path-to-folder> required");
+		return -1;
+	}
+	std::map<std::string, std::string > args;
+	if (!alprParseArgs(argc - 1, argv + 1, args)) {
+		printUsage();
+		return -1;
+	}
+	const std::string outputPath = (args.find("--output") != args.end()) ? args["--output"] : "../registered.txt";
+	const int numDecoders = (args.find("--decoders") != args.end()) ? std::atoi(args["--decoders"].c_str())
+		: std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+	const size_t queueDepth = (args.find("--queue") != args.end()) ? static_cast<size_t>(std::atoi(args["--queue"].c_str())) : 2 * static_cast<size_t>(numDecoders);
+	const int numRepeat = (args.find("--num_repeat") != args.end()) ? std::atoi(args["--num_repeat"].c_str()) : 7;
+	const double minConfidence = (args.find("--min_confidence") != args.end()) ? std::atof(args["--min_confidence"].c_str()) : 0.0;
+	if (numDecoders < 1 || numRepeat < 1) {
+		printUsage("--decoders and --num_repeat must be within [1, inf]");
+		return -1;
+	}
+
+	// Files to enroll from
+	std::vector<std::string> allFiles, files;
+	std::vector<bool> isVideo;
+	if (!alprListFiles(argv[1], allFiles)) {
+		return -1;
+	}
+	for (const std::string& path : allFiles) {
+		const std::string extension = extensionOf(path);
+		const bool photo = (extension == "jpg" || extension == "jpeg" || extension == "png" || extension == "bmp" || extension == "ppm" || extension == "pgm");
+		const bool video = (extension == "mp4" || extension == "avi" || extension == "mkv" || extension == "mov");
+		if (photo || video) {
+			files.push_back(path);
+			isVideo.push_back(video);
+		}
+	}
+	ULTALPR_SDK_PRINT_INFO("%zu photos and videos to enroll from (%zu files skipped)", files.size(), allFiles.size() - files.size());
+
+	AlprEnrollmentWriter registered;
+	if (!registered.open(outputPath)) {
+		return -1;
+	}
+
+	// Engine
+	const std::string engineName = (args.find("--engine") != args.end()) ? args["--engine"] : alprEngineDefault();
+	const std::string jsonConfig = alprEngineConfig(args, true); // whole photos: no detection ROI
+	std::unique_ptr<AlprEngine> engine(alprEngineCreate(engineName));
+	if (!engine) {
+		return -1;
+	}
+	ULTALPR_SDK_PRINT_INFO("Starting recognizer (%s)...", engine->name());
+	AlprEngineResult result = engine->init(jsonConfig);
+	if (!result.isOK()) {
+		ULTALPR_SDK_PRINT_ERROR("Failed to initialize the engine: %s", result.phrase.c_str());
+		return -1;
+	}
+
+	// Decoders: each one takes the next file, a video is decoded entirely by the same worker (frames in order).
+	// Photos are decoded as BGR24 like the video frames, into buffers recycled once recognized.
+	AlprBufferPool photoBuffers(queueDepth + numDecoders);
+	AlprBoundedQueue<EnrollItem> queue(queueDepth);
+	std::atomic<size_t> nextFile(0), numFailed(0);
+	std::vector<std::thread> decoders;
+	for (int d = 0; d < numDecoders; ++d) {
+		decoders.push_back(std::thread([&]() {
+			for (size_t index = nextFile++; index < files.size(); index = nextFile++) {
+				EnrollItem item;
+				item.source = index;
+				item.video = isVideo[index];
+				if (!item.video) {
+					item.photo = std::make_shared<AlprFile>();
+					if (!alprDecodeFile(files[index], *item.photo, ULTALPR_SDK_IMAGE_TYPE_BGR24, &photoBuffers)) {
+						++numFailed;
+						continue;
+					}
+					if (!queue.push(std::move(item))) {
+						return;
+					}
+					continue;
+				}
+				cv::VideoCapture cap(files[index]);
+				if (!cap.isOpened()) {
+					ULTALPR_SDK_PRINT_ERROR("Failed to open video: %s", files[index].c_str());
+					++numFailed;
+					continue;
+				}
+				cv::Mat frame;
+				while (cap.read(frame) && !frame.empty()) {
+					EnrollItem frameItem;
+					frameItem.source = index;
+					frameItem.video = true;
+					frameItem.frame = frame.clone();
+					if (!queue.push(std::move(frameItem))) {
+						return;
+					}
+				}
+				if (!queue.push(std::move(item))) { // end of the video
+					return;
+				}
+			}
+		}));
+	}
+	std::thread closer([&]() {
+		for (std::thread& decoder : decoders) {
+			decoder.join();
+		}
+		queue.close();
+	});
+
+	// Recognition, on this thread (the SDK engine is a singleton)
+	const AlprClock::time_point start = AlprClock::now();
+	AlprClock::time_point lastProgress = start;
+	std::map<size_t, AlprPlateVoter> voters; // videos being enrolled
+	size_t numPhotos = 0, numFrames = 0, numVideos = 0, numEnrolled = 0;
+	uint64_t processMicros = 0;
+	EnrollItem item;
+	while (queue.pop(item)) {
+		if (item.video && item.frame.empty()) {
+			voters.erase(item.source);
+			++numVideos;
+			continue;
+		}
+		const AlprClock::time_point processStart = AlprClock::now();
+		if (item.video) {
+			result = engine->process(ULTALPR_SDK_IMAGE_TYPE_BGR24, item.frame.data, item.frame.cols, item.frame.rows,
+				item.frame.step / item.frame.elemSize());
+			++numFrames;
+		}
+		else {
+			result = engine->process(item.photo->type, item.photo->uncompressedData, item.photo->width, item.photo->height);
+			++numPhotos;
+		}
+		processMicros += alprMicrosSince(processStart);
+		if (!result.isOK()) {
+			ULTALPR_SDK_PRINT_WARN("%s: %s", files[item.source].c_str(), result.phrase.c_str());
+		}
+		else {
+			std::map<size_t, AlprPlateVoter>::iterator voter = item.video
+				? voters.insert(std::make_pair(item.source, AlprPlateVoter(numRepeat))).first : voters.end();
+			if (voter != voters.end()) {
+				voter->second.nextFrame();
+			}
+			for (const AlprPlate& plate : alprParsePlates(result.json)) {
+				const bool confirmed = (voter != voters.end()) ? voter->second.vote(plate.text) : (plate.confidence >= minConfidence);
+				if (confirmed && registered.add(plate.text)) {
+					++numEnrolled;
+					ULTALPR_SDK_PRINT_INFO("Enrolled %s from %s", plate.text.c_str(), files[item.source].c_str());
+				}
+			}
+		}
+		registered.tick();
+		if (alprMicrosSince(lastProgress) >= 5000000) {
+			lastProgress = AlprClock::now();
+			const double seconds = alprMicrosSince(start) * 1e-6;
+			ULTALPR_SDK_PRINT_INFO("%zu/%zu files, %.1lf images/s (engine %.1lf ms/image), %zu plates enrolled, %zu queued",
+				numPhotos + numVideos, files.size(), (numPhotos + numFrames) / seconds, processMicros / 1000.0 / std::max<size_t>(1, numPhotos + numFrames),
+				numEnrolled, queue.size());
+		}
+	}
+	closer.join();
+	registered.close();
+
+	const double seconds = alprMicrosSince(start) * 1e-6;
+	ULTALPR_SDK_PRINT_INFO("Enrolled %zu new plates from %zu photos and %zu videos (%zu frames) in %.1lf seconds (%.1lf images/s), %zu files failed to decode",
+		numEnrolled, numPhotos, numVideos, numFrames, seconds, seconds > 0 ? (numPhotos + numFrames) / seconds : 0.0, numFailed.load());
+
+	ULTALPR_SDK_PRINT_INFO("Ending recognizer...");
+	engine->deInit();
+	return 0;
+}
+
+static void printUsage(const std::string& message /*= ""*/)
+{
+	if (!message.empty()) {
+		ULTALPR_SDK_PRINT_ERROR("%s", message.c_str());
+	}
+	ULTALPR_SDK_PRINT_INFO(
+		"\n********************************************************************************\n"
+		"enroll <path-to-folder>\n"
+		"\t[--output <path-to-watchlist>] \n"
+		"\t[--decoders <threads>] \n"
+		"\t[--queue <images>] \n"
+		"\t[--num_repeat <readings-to-confirm-a-plate:[1, inf]>] \n"
+		"\t[--min_confidence <percent>] \n"
+		"\t[--assets <path-to-assets-folder>] \n"
+		"\t[--engine <sdk / mock>] \n"
+		"\t[--mock_results <path-to-json-lines>] \n"
+		"\t[--mock_latency_ms <millis>] \n"
+		"\n"
+		"Options surrounded with [] are optional.\n"
+		"\n"
+		"<path-to-folder>: Photos (jpg, jpeg, png, bmp, ppm, pgm) and videos (mp4, avi, mkv, mov) in this folder and its sub-folders are enrolled. May also be a single file.\n\n"
+		"--output: Text watchlist the new plates are appended to, plates already there are skipped. Default: ../registered.txt.\n\n"
+		"--decoders: Number of decoder threads. Default: number of cores.\n\n"
+		"--queue: Decoded images waiting for the engine, at most. Default: 2 x --decoders.\n\n"
+		"--num_repeat: Number of frames of the same video a plate must be read on to be enrolled. Default: 7.\n\n"
+		"--min_confidence: Minimum recognition confidence for a plate read on a photo to be enrolled. Default: 0.\n\n"
+		"--assets: Path to the assets folder. Default: ../assets.\n\n"
+		"--engine: Recognition backend, see main. Default: sdk when built with the SDK, mock otherwise.\n\n"
+		"********************************************************************************\n"
+	);
+}
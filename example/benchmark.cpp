@@ -1,11 +1,23 @@
 #include <ultimateALPR-SDK-API-PUBLIC.h>
 #include <alpr_utils.h>
+#include <alpr_engine.h>
+#include <alpr_pipeline.h>
+#include <alpr_capture.h>
+#include <opencv2/core.hpp>
+#include <opencv2/videoio.hpp>
+#include <json.hpp> // nlohmann/json
 #include <chrono>
 #include <vector>
 #include <algorithm>
 #include <random>
-#include <mutex>
-#include <condition_variable>
+#include <atomic>
+#include <thread>
+#include <memory>
+#include <fstream>
+#include <sstream>
+#include <set>
+#include <iostream>
+#include <cmath>
 #if defined(_WIN32)
 #include <algorithm> // std::replace
 #endif
@@ -15,7 +27,7 @@ using namespace ultimateAlprSdk;
 // Configuration for ANPR deep learning engine
 static const char* __jsonConfig =
 "{"
-"\"debug_level\": \"info\","
+"\"debug_level\": \"fatal\","
 "\"debug_write_input_image_enabled\": false,"
 "\"debug_internal_data_path\": \".\","
 ""
@@ -37,38 +49,77 @@ static const char* __jsonConfig =
 "\"recogn_score_type\": \"min\""
 "";
 
-// Asset manager used on Android to files in "assets" folder
-#if ULTALPR_SDK_OS_ANDROID 
-#	define ASSET_MGR_PARAM() __sdk_android_assetmgr, 
-#else
-#	define ASSET_MGR_PARAM() 
-#endif /* ULTALPR_SDK_OS_ANDROID */
-
 // Including <Windows.h> add clashes between "std::max" and "::max"
 #define ULTAPR_MAX(a, b) (((a) > (b)) ? (a) : (b))
 
+typedef std::chrono::steady_clock BenchClock;
+
 /*
 * Parallel callback function used for notification. Not mandatory.
 * More info about parallel delivery: https://www.doubango.org/SDKs/anpr/docs/Parallel_versus_sequential_processing.html
+* We only count the results and remember when the last one arrived: printing them to the console
+* would be slower than the engine and would end up being what we measure.
 */
-static size_t parallelNotifCount = 0;
-static std::condition_variable parallelNotifCondVar;
-class MyUltAlprSdkParallelDeliveryCallback : public UltAlprSdkParallelDeliveryCallback {
-	virtual void onNewResult(const UltAlprSdkResult* result) const override {
-		ULTALPR_SDK_ASSERT(result != nullptr);
-		const std::string& json = result->json();
-		// Printing to the console could be very slow and delayed -> stop displaying the result as soon as all plates are processed
-		ULTALPR_SDK_PRINT_INFO("MyUltAlprSdkParallelDeliveryCallback::onNewResult(%d, %s, %zu): %s",
-			result->code(),
-			result->phrase(),
-			++parallelNotifCount,
-			!json.empty() ? json.c_str() : "{}"
-		);
-		parallelNotifCondVar.notify_one();
+static std::atomic<size_t> parallelNotifCount(0);
+static std::atomic<int64_t> parallelNotifLastNanos(0);
+class MyParallelDeliveryCallback : public AlprEngineCallback {
+	virtual void onNewResult(const AlprEngineResult& result) override {
+		parallelNotifLastNanos = std::chrono::duration_cast<std::chrono::nanoseconds>(BenchClock::now().time_since_epoch()).count();
+		++parallelNotifCount;
 	}
 };
 
+/*
+* One input handed to the engine. Points to data owned by an AlprFile or a decoded clip frame.
+*/
+struct BenchFrame {
+	ULTALPR_SDK_IMAGE_TYPE type;
+	const void* data;
+	size_t width;
+	size_t height;
+	bool positive; // only meaningful for the still images
+};
+
+/*
+* Outcome of one scenario run
+*/
+struct BenchResult {
+	std::string name;
+	nlohmann::json params;
+	bool parallel = false;
+	size_t frames = 0;
+	size_t notifications = 0;
+	double submitMillis = 0.0; // time spent in process() calls
+	double elapsedMillis = 0.0; // submit + wait for the last parallel result
+	std::vector<double> latencies; // per process() call, in millis
+	size_t rssKB = 0; // resident set size at the end of the run
+	size_t peakRssKB = 0; // high-water mark during the run (since the start of the process on kernels older than 4.0)
+	bool keepPlates = false; // sequential only: fill 'plates'
+	std::vector<std::set<std::string> > plates; // per process() call, normalized
+	nlohmann::json accuracy;
+};
+
+struct BenchState {
+	std::unique_ptr<AlprEngine> engine;
+	std::string jsonConfig;
+	std::string initializedConfig;
+	bool parallelEnabled = false;
+	bool initialized = false;
+	ULTALPR_SDK_IMAGE_TYPE warmUpType = ULTALPR_SDK_IMAGE_TYPE_RGB24;
+	MyParallelDeliveryCallback callback;
+};
+
 static void printUsage(const std::string& message = "");
+static bool engineSetup(BenchState& state, const bool parallel);
+static bool runFrames(BenchState& state, const std::vector<BenchFrame>& frames, const std::vector<size_t>& order, const size_t expectedNotifs, BenchResult& out);
+static nlohmann::json summarize(const BenchResult& result);
+static bool readMemoryUsage(size_t& rssKB, size_t& peakRssKB);
+static void resetPeakMemoryUsage();
+static std::vector<size_t> mixedOrder(const size_t loopCount, const double percentPositives);
+static std::vector<double> parseRates(const std::string& str);
+static bool runDecode(const std::string& source, const AlprCaptureOptions& options, const size_t maxFrames, BenchResult& out);
+static bool runImageDecode(const std::vector<std::string>& paths, const std::string& mode, const size_t loopCount, BenchResult& out);
+static void compareBackends(std::vector<BenchResult>& runs, const std::set<std::string>& expectedPlates);
 
 /*
 * Entry point
@@ -76,8 +127,6 @@ static void printUsage(const std::string& message = "");
 int main(int argc, char *argv[])
 {
 	// local variables
-	UltAlprSdkResult result;
-	MyUltAlprSdkParallelDeliveryCallback parallelDeliveryCallbackCallback;
 	std::string assetsFolder, licenseTokenData, licenseTokenFile;
 	bool isParallelDeliveryEnabled = true;
 	bool isRectificationEnabled = false;
@@ -88,9 +137,22 @@ int main(int argc, char *argv[])
 	std::string charset = "latin";
 	std::string openvinoDevice = "CPU";
 	size_t loopCount = 100;
+	size_t maxClipFrames = 300;
+	size_t numStreams = 4;
 	double percentPositives = .2; // 20%
+	std::vector<double> sweepRates = { 0.0, 0.25, 0.5, 0.75, 1.0 };
+	std::string scenarios = "all";
 	std::string pathFilePositive;
 	std::string pathFileNegative;
+	std::string pathClip;
+	std::string pathOutput;
+	std::string engineName = alprEngineDefault();
+	std::string pathMockResults;
+	double mockLatencyMillis = 0.0;
+	std::string decodeBackends = "auto,ffmpeg,gstreamer";
+	std::string decodeSource;
+	std::string inferenceBackends = "cpu,openvino,tensorrt";
+	std::set<std::string> clipPlates;
 
 	// Parsing args
 	std::map<std::string, std::string > args;
@@ -108,6 +170,15 @@ int main(int argc, char *argv[])
 	}
 	pathFilePositive = args["--positive"];
 	pathFileNegative = args["--negative"];
+	if (args.find("--clip") != args.end()) {
+		pathClip = args["--clip"];
+	}
+	if (args.find("--scenario") != args.end()) {
+		scenarios = args["--scenario"];
+	}
+	if (args.find("--output") != args.end()) {
+		pathOutput = args["--output"];
+	}
 	if (args.find("--rate") != args.end()) {
 		const double rate = std::atof(args["--rate"].c_str());
 		if (rate > 1.0 || rate < 0.0) {
@@ -116,6 +187,13 @@ int main(int argc, char *argv[])
 		}
 		percentPositives = rate;
 	}
+	if (args.find("--rates") != args.end()) {
+		sweepRates = parseRates(args["--rates"]);
+		if (sweepRates.empty()) {
+			printUsage("--rates must be a comma separated list of values within [0.0, 1.0]");
+			return -1;
+		}
+	}
 	if (args.find("--loops") != args.end()) {
 		const int loops = std::atoi(args["--loops"].c_str());
 		if (loops < 1) {
@@ -124,6 +202,51 @@ int main(int argc, char *argv[])
 		}
 		loopCount = static_cast<size_t>(loops);
 	}
+	if (args.find("--frames") != args.end()) {
+		const int frames = std::atoi(args["--frames"].c_str());
+		if (frames < 1) {
+			printUsage("--frames must be within [1, inf]");
+			return -1;
+		}
+		maxClipFrames = static_cast<size_t>(frames);
+	}
+	if (args.find("--streams") != args.end()) {
+		const int streams = std::atoi(args["--streams"].c_str());
+		if (streams < 1) {
+			printUsage("--streams must be within [1, inf]");
+			return -1;
+		}
+		numStreams = static_cast<size_t>(streams);
+	}
+	if (args.find("--decode_backends") != args.end()) {
+		decodeBackends = args["--decode_backends"];
+	}
+	decodeSource = (args.find("--decode_source") != args.end()) ? args["--decode_source"] : pathClip;
+	if (args.find("--backends") != args.end()) {
+		inferenceBackends = args["--backends"];
+	}
+	if (args.find("--clip_plates") != args.end()) {
+		std::ifstream plates(args["--clip_plates"].c_str());
+		if (!plates) {
+			ULTALPR_SDK_PRINT_ERROR("Failed to open plates file: %s", args["--clip_plates"].c_str());
+			return -1;
+		}
+		std::string plate;
+		while (plates >> plate) {
+			alprNormalizePlate(plate);
+			clipPlates.insert(plate);
+		}
+	}
+	const AlprCaptureOptions captureOptions = alprCaptureParseArgs(args);
+	if (args.find("--engine") != args.end()) {
+		engineName = args["--engine"];
+	}
+	if (args.find("--mock_results") != args.end()) {
+		pathMockResults = args["--mock_results"];
+	}
+	if (args.find("--mock_latency_ms") != args.end()) {
+		mockLatencyMillis = std::atof(args["--mock_latency_ms"].c_str());
+	}
 	if (args.find("--parallel") != args.end()) {
 		isParallelDeliveryEnabled = (args["--parallel"].compare("true") == 0);
 	}
@@ -163,7 +286,10 @@ int main(int argc, char *argv[])
 	if (args.find("--tokendata") != args.end()) {
 		licenseTokenData = args["--tokendata"];
 	}
-	
+	const bool runAll = (scenarios == "all");
+	const auto wants = [&](const std::string& name) {
+		return runAll || ("," + scenarios + ",").find("," + name + ",") != std::string::npos;
+	};
 
 	// Update JSON config
 	std::string jsonConfig = __jsonConfig;
@@ -187,100 +313,656 @@ int main(int argc, char *argv[])
 	if (!licenseTokenData.empty()) {
 		jsonConfig += std::string(",\"license_token_data\": \"") + licenseTokenData + std::string("\"");
 	}
-	
+	if (!pathMockResults.empty()) {
+		jsonConfig += std::string(",\"mock_results_file\": \"") + pathMockResults + std::string("\"");
+	}
+	jsonConfig += std::string(",\"mock_latency_ms\": ") + std::to_string(mockLatencyMillis);
+
 	jsonConfig += "}"; // end-of-config
 
 	// Read files
 	// Positive: the file contains at least one plate
 	// Negative: the file doesn't contain a plate
 	// Change positive rates to evaluate the detector versus recognizer
-	AlprFile filePositive, fileNegative;
-	if (!alprDecodeFile(pathFilePositive, filePositive)) {
+	const std::vector<std::string> pathsStills = { pathFilePositive, pathFileNegative };
+	std::vector<AlprFile> filesStills;
+	alprDecodeFiles(pathsStills, filesStills, ULTALPR_SDK_IMAGE_TYPE_RGB24);
+	const AlprFile& filePositive = filesStills[0];
+	const AlprFile& fileNegative = filesStills[1];
+	if (!filePositive.isValid()) {
 		ULTALPR_SDK_PRINT_INFO("Failed to read positive file: %s", pathFilePositive.c_str());
 		return -1;
 	}
-	if (!alprDecodeFile(pathFileNegative, fileNegative)) {
-		ULTALPR_SDK_PRINT_INFO("Failed to read positive file: %s", pathFilePositive.c_str());
+	if (!fileNegative.isValid()) {
+		ULTALPR_SDK_PRINT_INFO("Failed to read negative file: %s", pathFileNegative.c_str());
 		return -1;
 	}
+	const std::vector<BenchFrame> stills = {
+		{ fileNegative.type, fileNegative.uncompressedData, fileNegative.width, fileNegative.height, false },
+		{ filePositive.type, filePositive.uncompressedData, filePositive.width, filePositive.height, true },
+	};
 
-	// Create image indices
-	std::vector<size_t> indices(loopCount, 0);
+	// Decode the clip up-front so that decoding is not part of the timing
+	std::vector<cv::Mat> clipMats;
+	std::vector<BenchFrame> clipFrames;
+	if (!pathClip.empty() && (wants("clip") || wants("streams") || wants("backends"))) {
+		cv::VideoCapture cap(pathClip);
+		if (!cap.isOpened()) {
+			ULTALPR_SDK_PRINT_ERROR("Failed to open clip: %s", pathClip.c_str());
+			return -1;
+		}
+		cv::Mat frame;
+		while (clipMats.size() < maxClipFrames && cap.read(frame) && !frame.empty()) {
+			clipMats.push_back(frame.clone());
+		}
+		for (const cv::Mat& mat : clipMats) {
+			clipFrames.push_back({ ULTALPR_SDK_IMAGE_TYPE_BGR24, mat.data, static_cast<size_t>(mat.cols), static_cast<size_t>(mat.rows), false });
+		}
+		ULTALPR_SDK_PRINT_INFO("Decoded %zu frames from %s", clipFrames.size(), pathClip.c_str());
+	}
 
-	const int numPositives = static_cast<int>(loopCount * percentPositives);
-	for (int i = 0; i < numPositives; ++i) {
-		indices[i] = 1; // positive index
+	BenchState state;
+	state.engine.reset(alprEngineCreate(engineName));
+	if (!state.engine) {
+		printUsage("--engine must be sdk or mock");
+		return -1;
 	}
-	std::shuffle(std::begin(indices), std::end(indices), std::default_random_engine{}); // make the indices random
+	state.jsonConfig = jsonConfig;
+	state.warmUpType = filePositive.type;
+	std::vector<BenchResult> results;
 
-	// Init 
 	ULTALPR_SDK_PRINT_INFO("Starting benchmark...");
-	ULTALPR_SDK_ASSERT((result = UltAlprSdkEngine::init(
-		ASSET_MGR_PARAM()
-		jsonConfig.c_str(),
-		isParallelDeliveryEnabled ? &parallelDeliveryCallbackCallback : nullptr
-	)).isOK());
+
+	// Single image: latency of the recognizer alone
+	if (wants("single")) {
+		BenchResult res;
+		res.name = "single";
+		res.params["loops"] = loopCount;
+		if (!engineSetup(state, isParallelDeliveryEnabled)
+			|| !runFrames(state, stills, std::vector<size_t>(loopCount, 1), loopCount, res)) {
+			return -1;
+		}
+		results.push_back(res);
+	}
+
+	// Recorded clip: real traffic, frames in their recorded order
+	if (wants("clip")) {
+		if (clipFrames.empty()) {
+			ULTALPR_SDK_PRINT_INFO("Skipping 'clip' scenario: no --clip provided");
+		}
+		else {
+			std::vector<size_t> order(clipFrames.size());
+			for (size_t i = 0; i < order.size(); ++i) {
+				order[i] = i;
+			}
+			BenchResult res;
+			res.name = "clip";
+			res.params["clip"] = pathClip;
+			if (!engineSetup(state, isParallelDeliveryEnabled)
+				|| !runFrames(state, clipFrames, order, 0, res)) {
+				return -1;
+			}
+			results.push_back(res);
+		}
+	}
+
+	// N streams: one box multiplexing N cameras. Frames are interleaved round-robin,
+	// each stream starting at a different offset in the clip.
+	if (wants("streams")) {
+		if (clipFrames.empty()) {
+			ULTALPR_SDK_PRINT_INFO("Skipping 'streams' scenario: no --clip provided");
+		}
+		else {
+			std::vector<size_t> order;
+			order.reserve(clipFrames.size() * numStreams);
+			for (size_t i = 0; i < clipFrames.size(); ++i) {
+				for (size_t s = 0; s < numStreams; ++s) {
+					order.push_back((i + (s * clipFrames.size()) / numStreams) % clipFrames.size());
+				}
+			}
+			BenchResult res;
+			res.name = "streams";
+			res.params["clip"] = pathClip;
+			res.params["streams"] = numStreams;
+			if (!engineSetup(state, isParallelDeliveryEnabled)
+				|| !runFrames(state, clipFrames, order, 0, res)) {
+				return -1;
+			}
+			results.push_back(res);
+		}
+	}
+
+	// Positive ratio sweep: detector-only cost versus detector+recognizer cost
+	if (wants("sweep")) {
+		for (const double rate : sweepRates) {
+			const std::vector<size_t> order = mixedOrder(loopCount, rate);
+			BenchResult res;
+			std::ostringstream name;
+			name << "sweep@" << rate;
+			res.name = name.str();
+			res.params["loops"] = loopCount;
+			res.params["rate"] = rate;
+			if (!engineSetup(state, isParallelDeliveryEnabled)
+				|| !runFrames(state, stills, order, std::count(order.begin(), order.end(), 1), res)) {
+				return -1;
+			}
+			results.push_back(res);
+		}
+	}
+
+	// Parallel versus sequential delivery on the same mixed workload.
+	// More info: https://www.doubango.org/SDKs/anpr/docs/Parallel_versus_sequential_processing.html
+	if (wants("delivery")) {
+		const std::vector<size_t> order = mixedOrder(loopCount, percentPositives);
+		const size_t numPositives = std::count(order.begin(), order.end(), 1);
+		for (const bool parallel : { false, true }) {
+			BenchResult res;
+			res.name = parallel ? "delivery/parallel" : "delivery/sequential";
+			res.params["loops"] = loopCount;
+			res.params["rate"] = percentPositives;
+			if (!engineSetup(state, parallel)
+				|| !runFrames(state, stills, order, numPositives, res)) {
+				return -1;
+			}
+			results.push_back(res);
+		}
+	}
+
+	// Decode only, per capture backend: "name" or "name@threads" (e.g. ffmpeg@4)
+	if (wants("decode")) {
+		if (decodeSource.empty()) {
+			ULTALPR_SDK_PRINT_INFO("Skipping 'decode' scenario: no --clip nor --decode_source provided");
+		}
+		else {
+			std::istringstream list(decodeBackends);
+			std::string spec;
+			while (std::getline(list, spec, ',')) {
+				AlprCaptureOptions options = captureOptions;
+				const size_t at = spec.find('@');
+				options.backend = spec.substr(0, at);
+				if (at != std::string::npos) {
+					options.threads = std::atoi(spec.c_str() + at + 1);
+				}
+				BenchResult res;
+				res.name = "decode/" + spec;
+				res.params["source"] = decodeSource;
+				res.params["backend"] = options.backend;
+				res.params["threads"] = options.threads;
+				if (!runDecode(decodeSource, options, maxClipFrames, res)) {
+					ULTALPR_SDK_PRINT_INFO("Skipping '%s': backend not available", res.name.c_str());
+					continue;
+				}
+				results.push_back(res);
+			}
+		}
+	}
+
+	// Still images decoding, without the engine: new buffer per image, reused buffer, one image per core
+	if (wants("images")) {
+		for (const char* mode : { "alloc", "reuse", "parallel" }) {
+			BenchResult res;
+			res.name = std::string("images/") + mode;
+			res.params["loops"] = loopCount;
+#if ALPR_HAVE_LIBJPEG
+			res.params["decoder"] = "libjpeg";
+#else
+			res.params["decoder"] = "stb_image";
+#endif
+			if (!runImageDecode(pathsStills, mode, loopCount, res)) {
+				return -1;
+			}
+			results.push_back(res);
+		}
+	}
+
+	// Same frames through each inference backend, sequential delivery to compare the plates frame by frame.
+	// The recorded clip when there's one, the mixed workload of stills otherwise.
+	if (wants("backends")) {
+		const std::vector<BenchFrame>& frames = clipFrames.empty() ? stills : clipFrames;
+		std::vector<size_t> order = clipFrames.empty() ? mixedOrder(loopCount, percentPositives) : std::vector<size_t>(clipFrames.size());
+		for (size_t i = 0; !clipFrames.empty() && i < order.size(); ++i) {
+			order[i] = i;
+		}
+		// Names checked before running anything: a typo must not be reported as a missing backend
+		std::vector<std::string> backends;
+		std::istringstream list(inferenceBackends);
+		std::string name;
+		while (std::getline(list, name, ',')) {
+			if (alprEngineBackendConfig(jsonConfig, name).empty()) {
+				printUsage("--backends must be a comma separated list of cpu, openvino, tensorrt and auto");
+				return -1;
+			}
+			backends.push_back(name);
+		}
+		std::vector<BenchResult> runs;
+		for (const std::string& backend : backends) {
+			if (!alprEngineBackendAvailable(backend, assetsFolder.empty() ? "." : assetsFolder)) {
+				ULTALPR_SDK_PRINT_INFO("Skipping 'backends/%s': backend not available on this host", backend.c_str());
+				continue;
+			}
+			state.jsonConfig = alprEngineBackendConfig(jsonConfig, backend, openvinoDevice);
+			BenchResult res;
+			res.name = "backends/" + backend;
+			res.params["backend"] = backend;
+			res.params["frames_from"] = clipFrames.empty() ? "stills" : pathClip;
+			res.keepPlates = true;
+			if (!engineSetup(state, false)
+				|| !runFrames(state, frames, order, 0, res)) {
+				return -1;
+			}
+			runs.push_back(res);
+		}
+		state.jsonConfig = jsonConfig;
+		compareBackends(runs, clipPlates);
+		results.insert(results.end(), runs.begin(), runs.end());
+	}
+
+	// DeInit
+	ULTALPR_SDK_PRINT_INFO("Ending benchmark...");
+	if (state.initialized) {
+		ULTALPR_SDK_ASSERT(state.engine->deInit().isOK());
+	}
+
+	// Report
+	nlohmann::json report;
+	report["sdk_version"] = std::to_string(ULTALPR_SDK_VERSION_MAJOR) + "." + std::to_string(ULTALPR_SDK_VERSION_MINOR) + "." + std::to_string(ULTALPR_SDK_VERSION_MICRO);
+	report["positive"] = pathFilePositive;
+	report["negative"] = pathFileNegative;
+	report["engine"] = state.engine->name();
+	report["openvino_enabled"] = isOpenVinoEnabled;
+	report["hardware_concurrency"] = std::thread::hardware_concurrency();
+	report["scenarios"] = nlohmann::json::array();
+	for (const BenchResult& res : results) {
+		const nlohmann::json summary = summarize(res);
+		report["scenarios"].push_back(summary);
+		ULTALPR_SDK_PRINT_INFO("*** %-22s frames: %6zu, fps: %8.2lf, p50: %7.2lf ms, p95: %7.2lf ms, p99: %7.2lf ms, rss: %zu KB ***",
+			res.name.c_str(),
+			res.frames,
+			summary["fps"].get<double>(),
+			summary["latency_ms"]["p50"].get<double>(),
+			summary["latency_ms"]["p95"].get<double>(),
+			summary["latency_ms"]["p99"].get<double>(),
+			summary["rss_kb"].get<size_t>()
+		);
+	}
+	size_t rssKB = 0, peakRssKB = 0;
+	if (readMemoryUsage(rssKB, peakRssKB)) {
+		for (const BenchResult& res : results) { // the high-water mark is reset by every run
+			peakRssKB = std::max(peakRssKB, res.peakRssKB);
+		}
+		report["peak_rss_kb"] = peakRssKB;
+	}
+
+	if (!pathOutput.empty()) {
+		std::ofstream output(pathOutput.c_str());
+		if (!output) {
+			ULTALPR_SDK_PRINT_ERROR("Failed to open output file: %s", pathOutput.c_str());
+			return -1;
+		}
+		output << report.dump(2) << std::endl;
+		ULTALPR_SDK_PRINT_INFO("Results written to %s", pathOutput.c_str());
+	}
+	else {
+		std::cout << report.dump(2) << std::endl;
+	}
+
+	return 0;
+}
+
+/*
+* (Re)initialize the engine when the delivery mode changes. The models are loaded
+* and warmed up here so that it is not part of the timing.
+*/
+static bool engineSetup(BenchState& state, const bool parallel)
+{
+	if (state.initialized && state.parallelEnabled == parallel && state.initializedConfig == state.jsonConfig) {
+		return true;
+	}
+	AlprEngineResult result;
+	if (state.initialized) {
+		state.engine->deInit();
+		state.initialized = false;
+	}
+	if (!(result = state.engine->init(
+		state.jsonConfig,
+		parallel ? &state.callback : nullptr
+	)).isOK()) {
+		ULTALPR_SDK_PRINT_ERROR("Failed to initialize the engine: %s", result.phrase.c_str());
+		return false;
+	}
+	state.initialized = true;
+	state.parallelEnabled = parallel;
+	state.initializedConfig = state.jsonConfig;
 
 	// Warm up:
 	// First time the SDK is called we'll be loading the models into CPU or GPU and initializing
 	// some internal variables -> do not include this part in te timing.
 	// The warm up function will make fake inference to force the engine to load the models and init the vars.
-	if (loopCount > 1) {
-		ULTALPR_SDK_ASSERT((result = UltAlprSdkEngine::warmUp(
-			filePositive.type
-		)).isOK());
-	}
-
-	// Recognize/Process
-	const std::chrono::high_resolution_clock::time_point timeStart = std::chrono::high_resolution_clock::now();
-	const AlprFile* files[2] = { &fileNegative, &filePositive };
-	for (const auto& indice : indices) {
-		ULTALPR_SDK_PRINT_INFO("Recongnizing\n");
-		const AlprFile* file = files[indice];
-		ULTALPR_SDK_ASSERT((result = UltAlprSdkEngine::process(
-			file->type,
-			file->uncompressedData,
-			file->width,
-			file->height
-		)).isOK());
-	}
-	// Compute the estimated frame rate.
-	// At this step all frames are already processed but the result could be still on the delivery
-	// queue due to the console display latency. You can move here the code used to wait until all
-	// messages are displayed to include the delivery latency.
-	const std::chrono::high_resolution_clock::time_point timeEnd = std::chrono::high_resolution_clock::now();
-	const double elapsedTimeInMillis = std::chrono::duration_cast<std::chrono::duration<double >>(timeEnd - timeStart).count() * 1000.0;
-	ULTALPR_SDK_PRINT_INFO("Elapsed time (ALPR) = [[[ %lf millis ]]]", elapsedTimeInMillis);
-
-	// Printing to the console is very slow and use a low priority thread.
-	// Wait until all results are displayed.
-	if (isParallelDeliveryEnabled) {
-		static std::mutex parallelNotifMutex;
-		std::unique_lock<std::mutex > lk(parallelNotifMutex);
-		parallelNotifCondVar.wait_for(lk, 
-			std::chrono::milliseconds(1500), // maximum number of millis to wait for before giving up, must never wait this long unless your positive image doesn't contain a plate at all
-			[&numPositives] { return (parallelNotifCount == numPositives); }
+	if (!(result = state.engine->warmUp(state.warmUpType)).isOK()) {
+		ULTALPR_SDK_PRINT_ERROR("Failed to warm up the engine: %s", result.phrase.c_str());
+		return false;
+	}
+	return true;
+}
+
+/*
+* Feed frames[order[0]], frames[order[1]]... to the engine and time every call.
+* In parallel mode the run only ends when the delivery queue is drained: we wait for
+* 'expectedNotifs' results or for the callbacks to stop coming.
+*/
+static bool runFrames(BenchState& state, const std::vector<BenchFrame>& frames, const std::vector<size_t>& order, const size_t expectedNotifs, BenchResult& out)
+{
+	AlprEngineResult result;
+	out.parallel = state.parallelEnabled;
+	out.frames = order.size();
+	out.latencies.clear();
+	out.latencies.reserve(order.size());
+	out.plates.clear();
+	parallelNotifCount = 0;
+	parallelNotifLastNanos = 0;
+	resetPeakMemoryUsage();
+
+	const BenchClock::time_point timeStart = BenchClock::now();
+	for (const size_t index : order) {
+		const BenchFrame& frame = frames[index];
+		const BenchClock::time_point t0 = BenchClock::now();
+		result = state.engine->process(
+			frame.type,
+			frame.data,
+			frame.width,
+			frame.height
 		);
+		const BenchClock::time_point t1 = BenchClock::now();
+		if (!result.isOK()) {
+			ULTALPR_SDK_PRINT_ERROR("%s: process() failed: %s", out.name.c_str(), result.phrase.c_str());
+			return false;
+		}
+		out.latencies.push_back(std::chrono::duration_cast<std::chrono::duration<double, std::milli> >(t1 - t0).count());
+		if (!state.parallelEnabled && result.numPlates) {
+			++out.notifications;
+		}
+		if (out.keepPlates && !state.parallelEnabled) {
+			std::set<std::string> plates;
+			for (const AlprPlate& plate : alprParsePlates(result.json)) {
+				plates.insert(plate.text);
+			}
+			out.plates.push_back(plates);
+		}
 	}
+	const BenchClock::time_point timeSubmitted = BenchClock::now();
+	out.submitMillis = std::chrono::duration_cast<std::chrono::duration<double, std::milli> >(timeSubmitted - timeStart).count();
+	out.elapsedMillis = out.submitMillis;
 
-	// Print latest result
-	const std::string& json_ = result.json();
-	if (!json_.empty()) {
-		ULTALPR_SDK_PRINT_INFO("result: %s", json_.c_str());
+	if (state.parallelEnabled) {
+		// Results for frames without a plate are never delivered -> also stop once the callbacks go quiet
+		const std::chrono::milliseconds quiet(500), giveUp(5000);
+		size_t lastCount = parallelNotifCount;
+		BenchClock::time_point lastChange = BenchClock::now();
+		while ((expectedNotifs == 0 || parallelNotifCount < expectedNotifs)
+			&& (BenchClock::now() - lastChange) < quiet
+			&& (BenchClock::now() - timeSubmitted) < giveUp) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(2));
+			if (parallelNotifCount != lastCount) {
+				lastCount = parallelNotifCount;
+				lastChange = BenchClock::now();
+			}
+		}
+		out.notifications = parallelNotifCount;
+		const int64_t lastNanos = parallelNotifLastNanos;
+		if (lastNanos) {
+			const BenchClock::time_point timeLast = BenchClock::time_point(std::chrono::duration_cast<BenchClock::duration>(std::chrono::nanoseconds(lastNanos)));
+			out.elapsedMillis = std::chrono::duration_cast<std::chrono::duration<double, std::milli> >(ULTAPR_MAX(timeLast, timeSubmitted) - timeStart).count();
+		}
 	}
+	readMemoryUsage(out.rssKB, out.peakRssKB);
+	return true;
+}
 
-	// Print estimated frame rate
-	const double estimatedFps = 1000.f / (elapsedTimeInMillis / (double)loopCount);
-	ULTALPR_SDK_PRINT_INFO("*** elapsedTimeInMillis: %lf, estimatedFps: %lf ***", elapsedTimeInMillis, estimatedFps);
+/*
+* Nearest-rank percentile over a sorted list
+*/
+static double percentile(const std::vector<double>& sorted, const double p)
+{
+	if (sorted.empty()) {
+		return 0.0;
+	}
+	const size_t rank = static_cast<size_t>(std::ceil((p / 100.0) * sorted.size()));
+	return sorted[rank ? rank - 1 : 0];
+}
 
-	ULTALPR_SDK_PRINT_INFO("Press any key to terminate !!");
-	getchar();
+static nlohmann::json summarize(const BenchResult& result)
+{
+	std::vector<double> sorted = result.latencies;
+	std::sort(sorted.begin(), sorted.end());
+	double sum = 0.0;
+	for (const double v : sorted) {
+		sum += v;
+	}
 
-	// DeInit
-	ULTALPR_SDK_PRINT_INFO("Ending benchmark...");
-	ULTALPR_SDK_ASSERT((result = UltAlprSdkEngine::deInit()).isOK());
+	nlohmann::json summary;
+	summary["name"] = result.name;
+	summary["params"] = result.params;
+	summary["delivery"] = result.parallel ? "parallel" : "sequential";
+	summary["frames"] = result.frames;
+	summary["results_with_plates"] = result.notifications;
+	summary["submit_ms"] = result.submitMillis;
+	summary["elapsed_ms"] = result.elapsedMillis;
+	summary["fps"] = result.elapsedMillis > 0.0 ? (1000.0 * result.frames) / result.elapsedMillis : 0.0;
+	summary["latency_ms"]["mean"] = sorted.empty() ? 0.0 : sum / sorted.size();
+	summary["latency_ms"]["min"] = sorted.empty() ? 0.0 : sorted.front();
+	summary["latency_ms"]["p50"] = percentile(sorted, 50.0);
+	summary["latency_ms"]["p95"] = percentile(sorted, 95.0);
+	summary["latency_ms"]["p99"] = percentile(sorted, 99.0);
+	summary["latency_ms"]["max"] = sorted.empty() ? 0.0 : sorted.back();
+	summary["rss_kb"] = result.rssKB;
+	summary["peak_rss_kb"] = result.peakRssKB;
+	if (!result.accuracy.is_null()) {
+		summary["accuracy"] = result.accuracy;
+	}
+	return summary;
+}
 
-	return 0;
+/*
+* Accuracy of the backends relative to each other, there's no ground truth per frame:
+* 'agreement' is the share of frames where the backend reads the same plates as the first one (the reference),
+* 'plates_read' the number of plates over all frames and 'distinct_plates' the number of different texts.
+* With the list of the plates visible in the clip (--clip_plates), 'recall' is the share of them read at least
+* once and 'unexpected' the number of different texts that are not in the list (misreads).
+* Printed side by side with the throughput.
+*/
+static void compareBackends(std::vector<BenchResult>& runs, const std::set<std::string>& expectedPlates)
+{
+	if (runs.empty()) {
+		return;
+	}
+	const BenchResult& reference = runs.front();
+	ULTALPR_SDK_PRINT_INFO("*** %-12s %8s %9s %9s %10s %8s %8s %10s ***", "backend", "fps", "p50 ms", "p95 ms", "agreement", "plates", "distinct", "recall");
+	for (BenchResult& run : runs) {
+		size_t numAgreeing = 0, numPlates = 0;
+		std::set<std::string> distinct;
+		for (size_t i = 0; i < run.plates.size(); ++i) {
+			numAgreeing += (i < reference.plates.size() && run.plates[i] == reference.plates[i]);
+			numPlates += run.plates[i].size();
+			distinct.insert(run.plates[i].begin(), run.plates[i].end());
+		}
+		run.accuracy["reference"] = reference.params["backend"];
+		run.accuracy["agreement"] = run.plates.empty() ? 0.0 : static_cast<double>(numAgreeing) / run.plates.size();
+		run.accuracy["plates_read"] = numPlates;
+		run.accuracy["distinct_plates"] = distinct.size();
+		double recall = -1.0;
+		if (!expectedPlates.empty()) {
+			size_t numFound = 0, numUnexpected = 0;
+			for (const std::string& plate : distinct) {
+				if (expectedPlates.count(plate)) {
+					++numFound;
+				}
+				else {
+					++numUnexpected;
+				}
+			}
+			recall = static_cast<double>(numFound) / expectedPlates.size();
+			run.accuracy["recall"] = recall;
+			run.accuracy["unexpected"] = numUnexpected;
+		}
+		const nlohmann::json summary = summarize(run);
+		char recallText[16] = "-";
+		if (recall >= 0.0) {
+			snprintf(recallText, sizeof(recallText), "%.1lf%%", recall * 100.0);
+		}
+		ULTALPR_SDK_PRINT_INFO("*** %-12s %8.2lf %9.2lf %9.2lf %9.1lf%% %8zu %8zu %10s ***",
+			run.params["backend"].get<std::string>().c_str(),
+			summary["fps"].get<double>(),
+			summary["latency_ms"]["p50"].get<double>(),
+			summary["latency_ms"]["p95"].get<double>(),
+			run.accuracy["agreement"].get<double>() * 100.0,
+			numPlates,
+			distinct.size(),
+			recallText
+		);
+	}
+}
+
+/*
+* Decode up to 'maxFrames' frames with one capture backend and time every read.
+* Nothing else runs meanwhile: this is the decoder alone, the engine is not involved.
+*/
+static bool runDecode(const std::string& source, const AlprCaptureOptions& options, const size_t maxFrames, BenchResult& out)
+{
+	cv::VideoCapture cap;
+	if (!alprCaptureOpen(cap, source, options)) {
+		return false;
+	}
+	out.params["backend_name"] = cap.getBackendName();
+	out.frames = 0;
+	out.latencies.clear();
+	out.latencies.reserve(maxFrames);
+	resetPeakMemoryUsage();
+	cv::Mat frame;
+	const BenchClock::time_point timeStart = BenchClock::now();
+	while (out.frames < maxFrames) {
+		const BenchClock::time_point t0 = BenchClock::now();
+		if (!cap.read(frame) || frame.empty()) {
+			break;
+		}
+		const BenchClock::time_point t1 = BenchClock::now();
+		out.latencies.push_back(std::chrono::duration_cast<std::chrono::duration<double, std::milli> >(t1 - t0).count());
+		++out.frames;
+	}
+	out.submitMillis = std::chrono::duration_cast<std::chrono::duration<double, std::milli> >(BenchClock::now() - timeStart).count();
+	out.elapsedMillis = out.submitMillis;
+	readMemoryUsage(out.rssKB, out.peakRssKB);
+	return out.frames > 0;
+}
+
+/*
+* Decode the still images 'loopCount' times in turn, the engine is not involved. 'alloc': a new AlprFile,
+* hence a new buffer, per image. 'reuse': the same AlprFile for every image. 'parallel': batches of one
+* image per core decoded with alprDecodeFiles, the latency is then the batch time divided by its size.
+*/
+static bool runImageDecode(const std::vector<std::string>& paths, const std::string& mode, const size_t loopCount, BenchResult& out)
+{
+	const size_t numThreads = std::max<size_t>(1, std::thread::hardware_concurrency());
+	AlprFile reused;
+	std::vector<AlprFile> batch;
+	std::vector<std::string> batchPaths;
+	out.params["threads"] = (mode == "parallel") ? numThreads : 1;
+	out.frames = 0;
+	out.latencies.clear();
+	out.latencies.reserve(loopCount);
+	resetPeakMemoryUsage();
+	const BenchClock::time_point timeStart = BenchClock::now();
+	while (out.frames < loopCount) {
+		const BenchClock::time_point t0 = BenchClock::now();
+		size_t count = 1;
+		bool ok;
+		if (mode == "parallel") {
+			count = std::min(numThreads, loopCount - out.frames);
+			batchPaths.resize(count);
+			for (size_t i = 0; i < count; ++i) {
+				batchPaths[i] = paths[(out.frames + i) % paths.size()];
+			}
+			ok = (alprDecodeFiles(batchPaths, batch, ULTALPR_SDK_IMAGE_TYPE_RGB24, numThreads) == count);
+		}
+		else if (mode == "reuse") {
+			ok = alprDecodeFile(paths[out.frames % paths.size()], reused, ULTALPR_SDK_IMAGE_TYPE_RGB24);
+		}
+		else {
+			AlprFile file;
+			ok = alprDecodeFile(paths[out.frames % paths.size()], file, ULTALPR_SDK_IMAGE_TYPE_RGB24);
+		}
+		if (!ok) {
+			return false;
+		}
+		const double millis = std::chrono::duration_cast<std::chrono::duration<double, std::milli> >(BenchClock::now() - t0).count();
+		for (size_t i = 0; i < count; ++i) {
+			out.latencies.push_back(millis / count);
+		}
+		out.frames += count;
+	}
+	out.submitMillis = std::chrono::duration_cast<std::chrono::duration<double, std::milli> >(BenchClock::now() - timeStart).count();
+	out.elapsedMillis = out.submitMillis;
+	readMemoryUsage(out.rssKB, out.peakRssKB);
+	return true;
+}
+
+/*
+* Resident set size (current and high-water mark) as reported by the kernel
+*/
+static bool readMemoryUsage(size_t& rssKB, size_t& peakRssKB)
+{
+	std::ifstream status("/proc/self/status");
+	if (!status) {
+		return false;
+	}
+	std::string line;
+	while (std::getline(status, line)) {
+		if (line.compare(0, 6, "VmRSS:") == 0) {
+			rssKB = static_cast<size_t>(std::atol(line.c_str() + 6));
+		}
+		else if (line.compare(0, 6, "VmHWM:") == 0) {
+			peakRssKB = static_cast<size_t>(std::atol(line.c_str() + 6));
+		}
+	}
+	return true;
+}
+
+/*
+* Starts a new high-water mark (VmHWM) so that each run reports its own peak, Linux 4.0+
+*/
+static void resetPeakMemoryUsage()
+{
+	std::ofstream clearRefs("/proc/self/clear_refs");
+	clearRefs << "5";
+}
+
+/*
+* Shuffled mix of negative (0) and positive (1) indices. The seed is fixed so that
+* two runs feed the engine with the same sequence.
+*/
+static std::vector<size_t> mixedOrder(const size_t loopCount, const double percentPositives)
+{
+	std::vector<size_t> indices(loopCount, 0);
+	const size_t numPositives = static_cast<size_t>(loopCount * percentPositives);
+	for (size_t i = 0; i < numPositives; ++i) {
+		indices[i] = 1; // positive index
+	}
+	std::shuffle(std::begin(indices), std::end(indices), std::default_random_engine{}); // make the indices random
+	return indices;
+}
+
+static std::vector<double> parseRates(const std::string& str)
+{
+	std::vector<double> rates;
+	std::istringstream stream(str);
+	std::string item;
+	while (std::getline(stream, item, ',')) {
+		const double rate = std::atof(item.c_str());
+		if (item.empty() || rate > 1.0 || rate < 0.0) {
+			return std::vector<double>();
+		}
+		rates.push_back(rate);
+	}
+	return rates;
 }
 
 /*
@@ -297,6 +979,20 @@ static void printUsage(const std::string& message /*= ""*/)
 		"benchmark\n"
 		"\t--positive <path-to-image-with-a-plate> \n"
 		"\t--negative <path-to-image-without-a-plate> \n"
+		"\t[--scenario <comma-separated-list:single,clip,streams,sweep,delivery,decode,images,backends / all>] \n"
+		"\t[--clip <path-to-recorded-video>] \n"
+		"\t[--clip_plates <path-to-plates-list>] \n"
+		"\t[--backends <comma-separated-list:cpu,openvino,tensorrt,auto>] \n"
+		"\t[--frames <max-number-of-clip-frames:[1, inf]>] \n"
+		"\t[--decode_backends <comma-separated-list:auto,ffmpeg,gstreamer,v4l2 with optional @threads>] \n"
+		"\t[--decode_source <path-to-video / pipeline / device>] \n"
+		"\t[--capture_hwaccel <true / false>] [--capture_fourcc <pixel-format>] [--capture_buffers <count>] \n"
+		"\t[--streams <number-of-streams:[1, inf]>] \n"
+		"\t[--rates <comma-separated-positive-rates>] \n"
+		"\t[--output <path-to-json-results>] \n"
+		"\t[--engine <sdk / mock>] \n"
+		"\t[--mock_results <path-to-json-lines>] \n"
+		"\t[--mock_latency_ms <millis>] \n"
 		"\t[--assets <path-to-assets-folder>] \n"
 		"\t[--charset <recognition-charset:latin/korean/chinese>] \n"
 		"\t[--openvino_enabled <whether-to-enable-OpenVINO:true/false>] \n"
@@ -313,8 +1009,22 @@ static void printUsage(const std::string& message /*= ""*/)
 		"\n"
 		"Options surrounded with [] are optional.\n"
 		"\n"
-		"--positive: Path to an image(JPEG/PNG/BMP) with a license plate. This image will be used to evaluate the recognizer. You can use default image at ../../../assets/images/lic_us_1280x720.jpg.\n\n"
-		"--negative: Path to an image(JPEG/PNG/BMP) without a license plate. This image will be used to evaluate the detector. You can use default image at ../../../assets/images/london_traffic.jpg.\n\n"
+		"--positive: Path to an image(JPEG/PNG/BMP) with a license plate. This image will be used to evaluate the recognizer. You can use default image at ../assets/images/lic_us_1280x720.jpg.\n\n"
+		"--negative: Path to an image(JPEG/PNG/BMP) without a license plate. This image will be used to evaluate the detector. You can use default image at ../assets/images/london_traffic.jpg.\n\n"
+		"--scenario: Scenarios to run. 'single': positive image only, 'clip': every frame of --clip in order, 'streams': --streams interleaved copies of --clip, 'sweep': mixed workload for each --rates value, 'delivery': mixed workload in sequential then parallel mode, 'decode': --frames frames read from --decode_source with each of --decode_backends, without the engine, 'images': --loops decodes of --positive and --negative with a new buffer each time, a reused buffer and one image per core, without the engine, 'backends': every frame of --clip (the 'delivery' workload without a clip) through each of --backends in sequential mode, FPS and accuracy side by side. Default: all.\n\n"
+		"--clip: Path to a recorded video. The frames are decoded before the timing starts. Required by 'clip' and 'streams', which are skipped otherwise.\n\n"
+		"--clip_plates: Plates visible in --clip, separated by white spaces. The 'backends' scenario then reports the share of them each backend reads (recall) and its misreads. Default: none, the backends are only compared with the first one.\n\n"
+		"--backends: Inference backends compared by the 'backends' scenario, the first available one is the reference for the agreement. Unavailable backends are skipped (OpenVINO needs x86, TensorRT a Jetson). Default: cpu,openvino,tensorrt.\n\n"
+		"--frames: Maximum number of frames to decode from --clip. Default: 300.\n\n"
+		"--decode_backends: Capture backends compared by the 'decode' scenario, 'ffmpeg@4' is FFmpeg with 4 decoder threads. Unavailable backends are skipped. Default: auto,ffmpeg,gstreamer.\n\n"
+		"--decode_source: What the 'decode' scenario reads: file, GStreamer pipeline or V4L2 device. Default: --clip.\n\n"
+		"--capture_hwaccel, --capture_fourcc, --capture_buffers: Applied to every backend of the 'decode' scenario, see main's usage.\n\n"
+		"--streams: Number of streams to interleave in the 'streams' scenario. Default: 4.\n\n"
+		"--rates: Positive rates used by the 'sweep' scenario. Default: 0,0.25,0.5,0.75,1.\n\n"
+		"--output: Path to the JSON file where to write the results. The results are written to stdout when not provided.\n\n"
+		"--engine: Recognition backend. 'sdk' is ultimateALPR, 'mock' replays --mock_results with a synthetic latency and doesn't need the SDK. Default: sdk when built with the SDK, mock otherwise.\n\n"
+		"--mock_results: JSON Lines file with one SDK result per frame, replayed in a loop by the mock engine.\n\n"
+		"--mock_latency_ms: Synthetic processing time per frame for the mock engine. Default: 0.\n\n"
 		"--assets: Path to the assets folder containing the configuration files and models. Default value is the current folder.\n\n"
 		"--charset: Defines the recognition charset value (latin, korean, chinese...). Default: latin.\n\n"
 		"--openvino_enabled: Whether to enable OpenVINO. Tensorflow will be used when OpenVINO is disabled. Default: true.\n\n"
@@ -322,9 +1032,9 @@ static void printUsage(const std::string& message /*= ""*/)
 		"--klass_lpci_enabled: Whether to enable License Plate Country Identification (LPCI). More info at https://www.doubango.org/SDKs/anpr/docs/Features.html#license-plate-country-identification-lpci. Default: false.\n\n"
 		"--klass_vcr_enabled: Whether to enable Vehicle Color Recognition (VCR). More info at https://www.doubango.org/SDKs/anpr/docs/Features.html#vehicle-color-recognition-vcr. Default: false.\n\n"
 		"--klass_vmmr_enabled: Whether to enable Vehicle Make Model Recognition (VMMR). More info at https://www.doubango.org/SDKs/anpr/docs/Features.html#vehicle-make-model-recognition-vmmr. Default: false.\n\n"
-		"--loops: Number of times to run the processing pipeline.\n\n"
-		"--rate: Percentage value within[0.0, 1.0] defining the positive rate. The positive rate defines the percentage of images with a plate.\n\n"
-		"--parallel: Whether to enabled the parallel mode. More info about the parallel mode at https ://www.doubango.org/SDKs/anpr/docs/Parallel_versus_sequential_processing.html. Default: true.\n\n"
+		"--loops: Number of times to run the processing pipeline in the 'single', 'sweep' and 'delivery' scenarios, and to decode an image in the 'images' scenario. Default: 100.\n\n"
+		"--rate: Percentage value within[0.0, 1.0] defining the positive rate of the 'delivery' scenario. The positive rate defines the percentage of images with a plate. Default: 0.2.\n\n"
+		"--parallel: Whether to enabled the parallel mode for all scenarios but 'delivery'. In parallel mode the latency is the time to submit a frame. More info about the parallel mode at https ://www.doubango.org/SDKs/anpr/docs/Parallel_versus_sequential_processing.html. Default: true.\n\n"
 		"--rectify: Whether to enable the rectification layer. More info about the rectification layer at https://www.doubango.org/SDKs/anpr/docs/Rectification_layer.html. Default: false.\n\n"
 		"--tokenfile: Path to the file containing the base64 license token if you have one. If not provided then, the application will act like a trial version. Default: null.\n\n"
 		"--tokendata: Base64 license token if you have one. If not provided then, the application will act like a trial version. Default: null.\n\n"
@@ -202,7 +202,7 @@ int main(int argc, char *argv[])
 
 	// Decode image
 	AlprFile fileImage;
-	if (!alprDecodeFile(pathFileImage, fileImage)) {
+	if (!alprDecodeFile(pathFileImage, fileImage, ULTALPR_SDK_IMAGE_TYPE_RGB24)) {
 		ULTALPR_SDK_PRINT_INFO("Failed to read image file: %s", pathFileImage.c_str());
 		return -1;
 	}
@@ -0,0 +1,499 @@
+/*
+* Batch variant of main2.cpp (the single image recognizer): thousands of images per launch instead of one.
+* The engine is initialized and warmed up once, images are decoded ahead by a pool of threads and the
+* results are streamed as JSON Lines, one line per image:
+*	{"index": 0, "file": "a.jpg", "width": 1280, "height": 720, "decode_ms": 4.1, "process_ms": 52.3, "latency_ms": 52.3, "plates": [...]}
+* "plates" is the array from the SDK result, empty when none was found. In sequential mode the lines are in
+* input order and latency_ms is the process() call. In parallel mode (--parallel true) the lines come in the
+* order the results are delivered, latency_ms is from submission to delivery and the images without a plate,
+* never delivered, are written at the end without latency_ms.
+* Images that failed to decode are written with an "error" instead.
+*/
+
+#include <ultimateALPR-SDK-API-PUBLIC.h>
+#include <alpr_utils.h>
+#include <alpr_engine.h>
+#include <alpr_metrics.h>
+#include <alpr_queue.h>
+#include <json.hpp> // nlohmann/json
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <glob.h>
+#include <sys/stat.h>
+
+using namespace ultimateAlprSdk;
+
+// Configuration for ANPR deep learning engine
+static const char* __jsonConfig =
+"{"
+"\"debug_level\": \"fatal\","
+"\"debug_write_input_image_enabled\": false,"
+"\"debug_internal_data_path\": \".\","
+""
+"\"num_threads\": -1,"
+"\"gpgpu_enabled\": true,"
+""
+"\"klass_vcr_gamma\": 1.5,"
+""
+"\"detect_roi\": [0, 0, 0, 0],"
+"\"detect_minscore\": 0.1,"
+""
+"\"pyramidal_search_enabled\": true,"
+"\"pyramidal_search_sensitivity\": 0.28,"
+"\"pyramidal_search_minscore\": 0.3,"
+"\"pyramidal_search_min_image_size_inpixels\": 800,"
+""
+"\"recogn_minscore\": 0.3,"
+"\"recogn_score_type\": \"min\""
+"";
+
+/*
+* One image, from its decoding to its line in the output
+*/
+struct BatchImage {
+	size_t index = 0;
+	std::string file;
+	std::shared_ptr<AlprFile> data; // null when decoding failed
+	double decodeMillis = 0.0;
+	double processMillis = 0.0;
+	AlprClock::time_point submitted;
+};
+
+/*
+* JSON Lines output, shared by the main thread and the parallel delivery thread
+*/
+class BatchWriter {
+public:
+	BatchWriter(std::ostream& output) : m_Output(output), m_nNumLines(0), m_nNumPlates(0) {}
+
+	void write(const BatchImage& image, const std::string& resultJson, const double latencyMillis, const std::string& error = "") {
+		nlohmann::ordered_json line;
+		line["index"] = image.index;
+		line["file"] = image.file;
+		if (!error.empty()) {
+			line["error"] = error;
+		}
+		if (image.data) {
+			line["width"] = image.data->width;
+			line["height"] = image.data->height;
+		}
+		line["decode_ms"] = image.decodeMillis;
+		line["process_ms"] = image.processMillis;
+		if (latencyMillis >= 0.0) {
+			line["latency_ms"] = latencyMillis;
+		}
+		line["plates"] = nlohmann::ordered_json::array();
+		if (!resultJson.empty()) {
+			const nlohmann::ordered_json parsed = nlohmann::ordered_json::parse(resultJson, nullptr, false);
+			if (!parsed.is_discarded() && parsed.contains("plates") && parsed["plates"].is_array()) {
+				line["plates"] = parsed["plates"];
+			}
+		}
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_nNumPlates += line["plates"].size();
+		m_Output << line.dump() << "\n";
+		if (latencyMillis >= 0.0) {
+			m_Latencies.push_back(latencyMillis);
+		}
+		if ((++m_nNumLines % 64) == 0) {
+			m_Output.flush();
+		}
+	}
+
+	void flush() {
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Output.flush();
+	}
+
+	inline size_t numPlates() const { return m_nNumPlates; }
+	std::vector<double> latencies() const {
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		return m_Latencies;
+	}
+
+private:
+	std::ostream& m_Output;
+	mutable std::mutex m_Mutex;
+	size_t m_nNumLines;
+	size_t m_nNumPlates;
+	std::vector<double> m_Latencies;
+};
+
+/*
+* Parallel delivery: matches the results, tagged with the frame index since init(), to the submitted images.
+* A result may arrive before process() returns, whichever of the two comes second writes the line.
+*/
+class BatchDelivery : public AlprEngineCallback {
+public:
+	BatchDelivery(BatchWriter& writer) : m_Writer(writer), m_LastDelivery(AlprClock::time_point::min()) {}
+
+	void submitted(const int64_t frameId, BatchImage&& image) {
+		std::unique_lock<std::mutex> lock(m_Mutex);
+		std::map<int64_t, std::string>::iterator early = m_Early.find(frameId);
+		if (early == m_Early.end()) {
+			image.data.reset(); // the engine has its own copy
+			m_Pending[frameId] = std::move(image);
+			return;
+		}
+		const std::string json = std::move(early->second);
+		m_Early.erase(early);
+		lock.unlock();
+		m_Writer.write(image, json, alprMicrosSince(image.submitted) / 1000.0);
+	}
+
+	virtual void onNewResult(const AlprEngineResult& result) override {
+		std::unique_lock<std::mutex> lock(m_Mutex);
+		m_LastDelivery = AlprClock::now();
+		std::map<int64_t, BatchImage>::iterator pending = m_Pending.find(result.frameId);
+		if (pending == m_Pending.end()) {
+			m_Early[result.frameId] = result.json;
+			return;
+		}
+		const BatchImage image = std::move(pending->second);
+		m_Pending.erase(pending);
+		lock.unlock();
+		m_Writer.write(image, result.json, alprMicrosSince(image.submitted) / 1000.0);
+	}
+
+	/*
+	* Once everything is submitted: waits for the results, the images without a plate are never delivered
+	* so it stops once the callbacks are quiet for 'quietMillis', then writes them without plates.
+	*/
+	void drain(const uint64_t quietMillis) {
+		std::unique_lock<std::mutex> lock(m_Mutex);
+		const AlprClock::time_point start = AlprClock::now();
+		while (!m_Pending.empty() && alprMicrosSince(std::max(m_LastDelivery, start)) < quietMillis * 1000) {
+			lock.unlock();
+			std::this_thread::sleep_for(std::chrono::milliseconds(10));
+			lock.lock();
+		}
+		for (const std::pair<const int64_t, BatchImage>& pending : m_Pending) {
+			m_Writer.write(pending.second, "", -1.0);
+		}
+		m_Pending.clear();
+	}
+
+	// Time of the last result, the end of the run for the throughput (not the quiet period in drain())
+	AlprClock::time_point lastDelivery() {
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		return m_LastDelivery;
+	}
+
+private:
+	BatchWriter& m_Writer;
+	std::mutex m_Mutex;
+	std::map<int64_t, BatchImage> m_Pending;
+	std::map<int64_t, std::string> m_Early;
+	AlprClock::time_point m_LastDelivery;
+};
+
+static void printUsage(const std::string& message = "");
+
+/*
+* Expands --images: a folder (recursively), a glob pattern (quote it) or a single file
+*/
+static bool listImages(const std::string& spec, std::vector<std::string>& files)
+{
+	struct stat st;
+	if (spec.find_first_of("*?[") != std::string::npos && stat(spec.c_str(), &st) != 0) {
+		glob_t matches;
+		const int ret = glob(spec.c_str(), 0, nullptr, &matches);
+		if (ret != 0 && ret != GLOB_NOMATCH) {
+			ULTALPR_SDK_PRINT_ERROR("Invalid pattern: %s", spec.c_str());
+			return false;
+		}
+		for (size_t i = 0; ret == 0 && i < matches.gl_pathc; ++i) {
+			files.push_back(matches.gl_pathv[i]);
+		}
+		globfree(&matches);
+		return true;
+	}
+	return alprListFiles(spec, files);
+}
+
+/*
+* Entry point
+*/
+int main(int argc, char *argv[])
+{
+	std::map<std::string, std::string > args;
+	if (!alprParseArgs(argc, argv, args)) {
+		printUsage();
+		return -1;
+	}
+	if (args.find("--images") == args.end() && args.find("--list") == args.end()) {
+		printUsage("--images or --list required");
+		return -1;
+	}
+
+	// Images, in order
+	std::vector<std::string> files;
+	if (args.find("--images") != args.end() && !listImages(args["--images"], files)) {
+		return -1;
+	}
+	if (args.find("--list") != args.end()) {
+		std::ifstream fileList;
+		const bool fromStdin = (args["--list"] == "-");
+		if (!fromStdin) {
+			fileList.open(args["--list"].c_str());
+			if (!fileList) {
+				ULTALPR_SDK_PRINT_ERROR("Failed to open file list: %s", args["--list"].c_str());
+				return -1;
+			}
+		}
+		std::istream& input = fromStdin ? std::cin : fileList;
+		std::string line;
+		while (std::getline(input, line)) {
+			if (!line.empty() && line.back() == '\r') {
+				line.pop_back();
+			}
+			if (!line.empty() && line[0] != '#') {
+				files.push_back(line);
+			}
+		}
+	}
+	if (files.empty()) {
+		ULTALPR_SDK_PRINT_ERROR("No image to recognize");
+		return -1;
+	}
+
+	const bool isParallelDeliveryEnabled = (args.find("--parallel") != args.end()) && (args["--parallel"].compare("true") == 0);
+	const int numDecoders = (args.find("--decoders") != args.end()) ? std::atoi(args["--decoders"].c_str())
+		: std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+	const size_t queueDepth = (args.find("--queue") != args.end()) ? static_cast<size_t>(std::atoi(args["--queue"].c_str())) : 2 * static_cast<size_t>(numDecoders);
+	if (numDecoders < 1) {
+		printUsage("--decoders must be within [1, inf]");
+		return -1;
+	}
+
+	// Update JSON config
+	std::string jsonConfig = __jsonConfig;
+	if (args.find("--assets") != args.end()) {
+		jsonConfig += std::string(",\"assets_folder\": \"") + args["--assets"] + std::string("\"");
+	}
+	if (args.find("--charset") != args.end()) {
+		jsonConfig += std::string(",\"charset\": \"") + args["--charset"] + std::string("\"");
+	}
+	jsonConfig += std::string(",\"recogn_rectify_enabled\": ") + ((args.find("--rectify") != args.end() && args["--rectify"] == "true") ? "true" : "false");
+	jsonConfig += std::string(",\"openvino_enabled\": ") + ((args.find("--openvino_enabled") == args.end() || args["--openvino_enabled"] == "true") ? "true" : "false");
+	if (args.find("--openvino_device") != args.end()) {
+		jsonConfig += std::string(",\"openvino_device\": \"") + args["--openvino_device"] + std::string("\"");
+	}
+	jsonConfig += std::string(",\"klass_lpci_enabled\": ") + ((args.find("--klass_lpci_enabled") != args.end() && args["--klass_lpci_enabled"] == "true") ? "true" : "false");
+	jsonConfig += std::string(",\"klass_vcr_enabled\": ") + ((args.find("--klass_vcr_enabled") != args.end() && args["--klass_vcr_enabled"] == "true") ? "true" : "false");
+	jsonConfig += std::string(",\"klass_vmmr_enabled\": ") + ((args.find("--klass_vmmr_enabled") != args.end() && args["--klass_vmmr_enabled"] == "true") ? "true" : "false");
+	if (args.find("--tokenfile") != args.end()) {
+		jsonConfig += std::string(",\"license_token_file\": \"") + args["--tokenfile"] + std::string("\"");
+	}
+	if (args.find("--tokendata") != args.end()) {
+		jsonConfig += std::string(",\"license_token_data\": \"") + args["--tokendata"] + std::string("\"");
+	}
+	if (args.find("--mock_results") != args.end()) {
+		jsonConfig += std::string(",\"mock_results_file\": \"") + args["--mock_results"] + std::string("\"");
+	}
+	if (args.find("--mock_latency_ms") != args.end()) {
+		jsonConfig += std::string(",\"mock_latency_ms\": ") + std::to_string(std::atof(args["--mock_latency_ms"].c_str()));
+	}
+	jsonConfig += "}"; // end-of-config
+
+	// Output
+	std::ofstream outputFile;
+	if (args.find("--output") != args.end()) {
+		outputFile.open(args["--output"].c_str());
+		if (!outputFile) {
+			ULTALPR_SDK_PRINT_ERROR("Failed to create output file: %s", args["--output"].c_str());
+			return -1;
+		}
+	}
+	BatchWriter writer(outputFile.is_open() ? outputFile : std::cout);
+	BatchDelivery delivery(writer);
+
+	// Init and warm up, once
+	const std::string engineName = (args.find("--engine") != args.end()) ? args["--engine"] : alprEngineDefault();
+	std::unique_ptr<AlprEngine> engine(alprEngineCreate(engineName));
+	if (!engine) {
+		printUsage("--engine must be sdk or mock");
+		return -1;
+	}
+	ULTALPR_SDK_PRINT_INFO("Starting recognizer (%s, %s delivery) for %zu images...", engine->name(), isParallelDeliveryEnabled ? "parallel" : "sequential", files.size());
+	const AlprClock::time_point initStart = AlprClock::now();
+	// Warmed up with the pixel format the images will have (see alprDecodeFile), before the delivery callback is set
+	AlprEngineResult result = alprEngineInitWarm(*engine, jsonConfig, ULTALPR_SDK_IMAGE_TYPE_BGR24, isParallelDeliveryEnabled ? &delivery : nullptr);
+	if (!result.isOK()) {
+		ULTALPR_SDK_PRINT_ERROR("Failed to initialize the engine: %s", result.phrase.c_str());
+		return -1;
+	}
+	ULTALPR_SDK_PRINT_INFO("Engine ready in %.1lf ms", alprMicrosSince(initStart) / 1000.0);
+
+	// Decoders, at most --queue images ahead of the engine
+	AlprBufferPool imageBuffers(queueDepth + numDecoders);
+	std::mutex orderMutex;
+	std::condition_variable orderChanged;
+	size_t nextToQueue = 0; // the images are queued in input order
+	AlprBoundedQueue<BatchImage> queue(queueDepth);
+	std::atomic<size_t> nextFile(0), numFailed(0);
+	std::vector<std::thread> decoders;
+	for (int d = 0; d < numDecoders; ++d) {
+		decoders.push_back(std::thread([&]() {
+			for (size_t index = nextFile++; index < files.size(); index = nextFile++) {
+				BatchImage image;
+				image.index = index;
+				image.file = files[index];
+				image.data = std::make_shared<AlprFile>();
+				const AlprClock::time_point decodeStart = AlprClock::now();
+				if (!alprDecodeFile(files[index], *image.data, ULTALPR_SDK_IMAGE_TYPE_BGR24, &imageBuffers)) {
+					image.data.reset();
+					++numFailed;
+				}
+				image.decodeMillis = alprMicrosSince(decodeStart) / 1000.0;
+				std::unique_lock<std::mutex> lock(orderMutex);
+				orderChanged.wait(lock, [&] { return nextToQueue == index; });
+				const bool pushed = queue.push(std::move(image));
+				++nextToQueue;
+				lock.unlock();
+				orderChanged.notify_all();
+				if (!pushed) {
+					return;
+				}
+			}
+		}));
+	}
+	std::thread closer([&]() {
+		for (std::thread& decoder : decoders) {
+			decoder.join();
+		}
+		queue.close();
+	});
+
+	// Recognition, on this thread
+	const AlprClock::time_point start = AlprClock::now();
+	AlprClock::time_point lastProgress = start;
+	size_t numImages = 0;
+	int64_t nextFrameId = 0; // frames since init(), when the result doesn't tell
+	BatchImage image;
+	while (queue.pop(image)) {
+		if (!image.data) {
+			writer.write(image, "", -1.0, "decoding failed");
+			continue;
+		}
+		image.submitted = AlprClock::now();
+		result = engine->process(image.data->type, image.data->uncompressedData, image.data->width, image.data->height);
+		image.processMillis = alprMicrosSince(image.submitted) / 1000.0;
+		++numImages;
+		if (!result.isOK()) {
+			writer.write(image, "", -1.0, result.phrase);
+		}
+		else if (!isParallelDeliveryEnabled) {
+			writer.write(image, result.json, image.processMillis);
+		}
+		else {
+			int64_t frameId = result.frameId;
+			if (frameId < 0 && !result.json.empty()) {
+				const nlohmann::json parsed = nlohmann::json::parse(result.json, nullptr, false);
+				if (!parsed.is_discarded() && parsed.contains("frame_id")) {
+					frameId = parsed["frame_id"].get<int64_t>();
+				}
+			}
+			if (frameId < 0) {
+				frameId = nextFrameId;
+			}
+			nextFrameId = frameId + 1;
+			delivery.submitted(frameId, std::move(image));
+		}
+		image = BatchImage(); // buffer back to the pool
+		if (alprMicrosSince(lastProgress) >= 5000000) {
+			lastProgress = AlprClock::now();
+			const double seconds = alprMicrosSince(start) * 1e-6;
+			ULTALPR_SDK_PRINT_INFO("%zu/%zu images, %.1lf images/s", numImages + numFailed, files.size(), numImages / seconds);
+		}
+	}
+	closer.join();
+	AlprClock::time_point end = AlprClock::now();
+	if (isParallelDeliveryEnabled) {
+		delivery.drain(2000);
+		end = std::max(end, delivery.lastDelivery());
+	}
+	writer.flush();
+
+	// Summary
+	const double seconds = alprMicrosSince(start, end) * 1e-6;
+	std::vector<double> latencies = writer.latencies();
+	std::sort(latencies.begin(), latencies.end());
+	const auto percentile = [&latencies](const double p) {
+		return latencies.empty() ? 0.0 : latencies[std::min(latencies.size() - 1, static_cast<size_t>((p / 100.0) * latencies.size()))];
+	};
+	ULTALPR_SDK_PRINT_INFO("%zu images in %.1lf seconds (%.1lf images/s), %zu plates, %zu failed to decode, latency p50: %.1lf ms, p95: %.1lf ms, max: %.1lf ms",
+		numImages, seconds, seconds > 0 ? numImages / seconds : 0.0, writer.numPlates(), numFailed.load(), percentile(50), percentile(95), latencies.empty() ? 0.0 : latencies.back());
+
+	// DeInit
+	ULTALPR_SDK_PRINT_INFO("Ending recognizer...");
+	engine->deInit();
+
+	return 0;
+}
+
+/*
+* Print usage
+*/
+static void printUsage(const std::string& message /*= ""*/)
+{
+	if (!message.empty()) {
+		ULTALPR_SDK_PRINT_ERROR("%s", message.c_str());
+	}
+
+	ULTALPR_SDK_PRINT_INFO(
+		"\n********************************************************************************\n"
+		"recognizer_batch\n"
+		"\t--images <path-to-folder / 'glob-pattern' / path-to-image> \n"
+		"\t--list <path-to-file-list / -> \n"
+		"\t[--output <path-to-json-lines>] \n"
+		"\t[--parallel <whether-to-enable-parallel-mode:true / false>] \n"
+		"\t[--decoders <threads>] \n"
+		"\t[--queue <images>] \n"
+		"\t[--engine <sdk / mock>] \n"
+		"\t[--mock_results <path-to-json-lines>] \n"
+		"\t[--mock_latency_ms <millis>] \n"
+		"\t[--assets <path-to-assets-folder>] \n"
+		"\t[--charset <recognition-charset:latin/korean/chinese>] \n"
+		"\t[--openvino_enabled <whether-to-enable-OpenVINO:true/false>] \n"
+		"\t[--openvino_device <openvino_device-to-use>] \n"
+		"\t[--klass_lpci_enabled <whether-to-enable-LPCI:true/false>] \n"
+		"\t[--klass_vcr_enabled <whether-to-enable-VCR:true/false>] \n"
+		"\t[--klass_vmmr_enabled <whether-to-enable-VMMR:true/false>] \n"
+		"\t[--rectify <whether-to-enable-rectification-layer:true / false>] \n"
+		"\t[--tokenfile <path-to-license-token-file>] \n"
+		"\t[--tokendata <base64-license-token-data>] \n"
+		"\n"
+		"Options surrounded with [] are optional, at least one of --images and --list is required.\n"
+		"\n"
+		"--images: Images (JPEG/PNG/BMP/PPM/PGM) to recognize: every file in a folder and its sub-folders, the files matching a glob pattern (quoted, e.g. '../evidence/*/*.jpg') or a single image.\n\n"
+		"--list: File with one image path per line, '-' for stdin. Appended after --images.\n\n"
+		"--output: Path to the JSON Lines file where to write one result per image. Default: stdout.\n\n"
+		"--parallel: Whether to enable the parallel mode, the results are then written in delivery order. More info about the parallel mode at https://www.doubango.org/SDKs/anpr/docs/Parallel_versus_sequential_processing.html. Default: false.\n\n"
+		"--decoders: Number of decoder threads. Default: number of cores.\n\n"
+		"--queue: Decoded images waiting for the engine, at most. Default: 2 x --decoders.\n\n"
+		"--engine: Recognition backend. 'sdk' is ultimateALPR, 'mock' replays --mock_results with a synthetic latency and doesn't need the SDK. Default: sdk when built with the SDK, mock otherwise.\n\n"
+		"--assets: Path to the assets folder containing the configuration files and models. Default value is the current folder.\n\n"
+		"--charset: Defines the recognition charset value (latin, korean, chinese...). Default: latin.\n\n"
+		"--openvino_enabled: Whether to enable OpenVINO. Tensorflow will be used when OpenVINO is disabled. Default: true.\n\n"
+		"--openvino_device: Defines the OpenVINO device to use (CPU, GPU, FPGA...). More info at https://www.doubango.org/SDKs/anpr/docs/Configuration_options.html#openvino_device. Default: CPU.\n\n"
+		"--klass_lpci_enabled: Whether to enable License Plate Country Identification (LPCI). More info at https://www.doubango.org/SDKs/anpr/docs/Features.html#license-plate-country-identification-lpci. Default: false.\n\n"
+		"--klass_vcr_enabled: Whether to enable Vehicle Color Recognition (VCR). More info at https://www.doubango.org/SDKs/anpr/docs/Features.html#vehicle-color-recognition-vcr. Default: false.\n\n"
+		"--klass_vmmr_enabled: Whether to enable Vehicle Make Model Recognition (VMMR). More info at https://www.doubango.org/SDKs/anpr/docs/Features.html#vehicle-make-model-recognition-vmmr. Default: false.\n\n"
+		"--rectify: Whether to enable the rectification layer. More info about the rectification layer at https://www.doubango.org/SDKs/anpr/docs/Rectification_layer.html. Default: false.\n\n"
+		"--tokenfile: Path to the file containing the base64 license token if you have one. If not provided then, the application will act like a trial version. Default: null.\n\n"
+		"--tokendata: Base64 license token if you have one. If not provided then, the application will act like a trial version. Default: null.\n\n"
+		"********************************************************************************\n"
+	);
+}
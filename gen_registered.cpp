@@ -1,5 +1,6 @@
 #include <ultimateALPR-SDK-API-PUBLIC.h>
 #include <alpr_utils.h>
+#include <alpr_enroll.h>
 #include <opencv2/opencv.hpp>
 #include <opencv2/core.hpp>
 #include <opencv2/videoio.hpp>
@@ -60,8 +61,10 @@ int main(int argc, char** argv) {
 	int numRepeat = 7, refresh = 10000, residual = 200;
 	int numIter = 0;
 	std::vector<std::string> allPrevDigits;
-	std::fstream registered;
-	registered.open("../registered.txt", std::ios::app);
+	AlprEnrollmentWriter registered;
+	if (!registered.open("../registered.txt")) {
+		return -1;
+	}
 
 
     while (true) {
@@ -100,7 +103,9 @@ int main(int argc, char** argv) {
 	
 						allPrevDigits.push_back(digits);
 						if (std::count(allPrevDigits.begin(), allPrevDigits.end(), digits) == numRepeat) {
-							registered << digits << std::endl;
+							if (registered.add(digits)) {
+								ULTALPR_SDK_PRINT_INFO("Enrolled %s", digits.c_str());
+							}
 						}
 
 						cv::putText(
@@ -125,12 +130,15 @@ int main(int argc, char** argv) {
 			}
 		}
 
+		registered.tick();
+
         // show live and wait for a key with timeout long enough to show images
         cv::imshow("Live", frame);
         if (cv::waitKey(5) >= 0)
             break;
     }
 	registered.close();
+	ULTALPR_SDK_PRINT_INFO("%zu new plates enrolled", registered.numWritten());
     // the camera will be deinitialized automatically in VideoCapture destructor
 	// DeInit
 		ULTALPR_SDK_PRINT_INFO("Ending recognizer...");
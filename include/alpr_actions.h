@@ -0,0 +1,107 @@
+#if !defined(_ALPR_ACTIONS_H_)
+#define _ALPR_ACTIONS_H_
+
+#include <ultimateALPR-SDK-API-PUBLIC.h>
+#include <alpr_watchlist.h>
+#include <opencv2/core.hpp>
+#include <json.hpp> // nlohmann/json
+#include <fstream>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/*
+* What a confirmed watchlist hit does, per category:
+*	"sound": file played by mplayer, "" for none
+*	"colour": [R, G, B] of the overlay flashed on the video
+*	"log_only": only written to the alerts log, no sound nor overlay (e.g. VIPs on an allowlist)
+*	"cooldown_s": the same plate doesn't alert again within this many seconds (video time)
+*/
+struct AlprAlertAction {
+	std::string sound = "../sound/sound.mp3";
+	cv::Scalar colour = cv::Scalar(0, 0, 255); // BGR
+	bool logOnly = false;
+	double cooldownSeconds = 0.0;
+};
+
+/*
+* Action table loaded from JSON, keyed by category name, e.g.
+*	{"default": {"sound": "../sound/sound.mp3"}, "stolen": {"colour": [255, 0, 0], "cooldown_s": 60}, "vip": {"log_only": true}}
+* Plates without a category, or with a category missing from the table, get "default" (the historical
+* behaviour when it is missing too). bind() resolves the watchlist's categories once: the action of a
+* hit is then an array access with the category returned by the lookup.
+*/
+class AlprActionTable {
+public:
+	bool load(const std::string& path) {
+		std::ifstream file(path.c_str());
+		if (!file) {
+			ULTALPR_SDK_PRINT_ERROR("Failed to open alert actions: %s", path.c_str());
+			return false;
+		}
+		const nlohmann::json parsed = nlohmann::json::parse(file, nullptr, false);
+		if (parsed.is_discarded() || !parsed.is_object()) {
+			ULTALPR_SDK_PRINT_ERROR("%s: expected a JSON object of actions by category", path.c_str());
+			return false;
+		}
+		m_Actions.clear();
+		for (nlohmann::json::const_iterator it = parsed.begin(); it != parsed.end(); ++it) {
+			const nlohmann::json& entry = it.value();
+			AlprAlertAction action;
+			action.sound = entry.value("sound", action.sound);
+			action.logOnly = entry.value("log_only", false);
+			action.cooldownSeconds = entry.value("cooldown_s", 0.0);
+			if (entry.contains("colour")) {
+				const std::vector<double> rgb = entry["colour"].is_array() ? entry["colour"].get<std::vector<double> >() : std::vector<double>();
+				if (rgb.size() != 3) {
+					ULTALPR_SDK_PRINT_ERROR("%s: colour of '%s' must be [R, G, B]", path.c_str(), it.key().c_str());
+					return false;
+				}
+				action.colour = cv::Scalar(rgb[2], rgb[1], rgb[0]);
+			}
+			m_Actions[it.key()] = action;
+		}
+		return true;
+	}
+
+	void bind(const AlprWatchlist& watchlist) {
+		const std::map<std::string, AlprAlertAction>::const_iterator fallback = m_Actions.find("default");
+		m_ByCategory.assign(watchlist.numCategories(), (fallback != m_Actions.end()) ? fallback->second : AlprAlertAction());
+		for (size_t i = 1; i < m_ByCategory.size(); ++i) {
+			const std::map<std::string, AlprAlertAction>::const_iterator it = m_Actions.find(watchlist.categoryName(static_cast<uint8_t>(i)));
+			if (it != m_Actions.end()) {
+				m_ByCategory[i] = it->second;
+			}
+			else {
+				ULTALPR_SDK_PRINT_WARN("No alert action for the watchlist category '%s', using the default one", watchlist.categoryName(static_cast<uint8_t>(i)).c_str());
+			}
+		}
+	}
+
+	inline const AlprAlertAction& action(const uint8_t category) const {
+		return m_ByCategory[category < m_ByCategory.size() ? category : 0];
+	}
+
+	/*
+	* False when 'plate' already alerted less than the action's cooldown ago, otherwise records the alert
+	*/
+	bool admit(const std::string& plate, const AlprAlertAction& action, const uint64_t timestampMicros) {
+		if (action.cooldownSeconds <= 0.0) {
+			return true;
+		}
+		std::unordered_map<std::string, uint64_t>::iterator last = m_LastAlertMicros.find(plate);
+		if (last != m_LastAlertMicros.end() && timestampMicros < last->second + static_cast<uint64_t>(action.cooldownSeconds * 1e6)) {
+			return false;
+		}
+		m_LastAlertMicros[plate] = timestampMicros;
+		return true;
+	}
+
+private:
+	std::map<std::string, AlprAlertAction> m_Actions;
+	std::vector<AlprAlertAction> m_ByCategory;
+	std::unordered_map<std::string, uint64_t> m_LastAlertMicros;
+};
+
+#endif /* _ALPR_ACTIONS_H_ */
@@ -0,0 +1,125 @@
+#if !defined(_ALPR_BLOOM_H_)
+#define _ALPR_BLOOM_H_
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+/*
+* Split block Bloom filter: each key sets one bit in each of the 8 32-bit words of one 256-bit block,
+* so a probe touches a single cache line. The 8 words are handled by the same loop without any branch,
+* which the compiler turns into SIMD (AVX2 on x86, NEON on the Jetson) at -O3.
+* About 0.5% false positives at 12 bits per key. Keys are expected to be well mixed 64-bit hashes.
+* The blocks can be serialized (data()) and later attached read-only from a mapped file (attach()).
+*/
+class AlprBloomFilter {
+public:
+	static const size_t kBlockSize = 32;
+
+	AlprBloomFilter() : m_pBlocks(nullptr), m_nNumBlocks(0), m_bOwned(false) {}
+	~AlprBloomFilter() {
+		release();
+	}
+
+	static inline size_t numBlocksFor(const size_t numKeys, const size_t bitsPerKey = 12) {
+		return (numKeys * bitsPerKey + 255) / 256;
+	}
+
+	void init(const size_t numKeys, const size_t bitsPerKey = 12) {
+		release();
+		m_nNumBlocks = numBlocksFor(numKeys, bitsPerKey);
+		if (!m_nNumBlocks) {
+			return;
+		}
+		void* blocks = nullptr;
+		if (posix_memalign(&blocks, 64, m_nNumBlocks * sizeof(Block)) != 0) {
+			m_nNumBlocks = 0;
+			return;
+		}
+		std::memset(blocks, 0, m_nNumBlocks * sizeof(Block));
+		m_pBlocks = static_cast<Block*>(blocks);
+		m_bOwned = true;
+	}
+
+	/*
+	* Uses 'numBlocks' blocks written by data() without copying them, e.g. from a read-only mapping that outlives
+	* the filter. 'blocks' should be 64-byte aligned. No insert() afterwards.
+	*/
+	void attach(const void* blocks, const size_t numBlocks) {
+		release();
+		m_pBlocks = static_cast<Block*>(const_cast<void*>(blocks));
+		m_nNumBlocks = blocks ? numBlocks : 0;
+	}
+
+	inline const void* data() const {
+		return m_pBlocks;
+	}
+
+	inline bool enabled() const {
+		return m_nNumBlocks != 0;
+	}
+
+	inline size_t sizeInBytes() const {
+		return m_nNumBlocks * sizeof(Block);
+	}
+
+	inline void insert(const uint64_t hash) {
+		uint32_t mask[8];
+		makeMask(static_cast<uint32_t>(hash), mask);
+		Block& block = m_pBlocks[blockIndex(hash)];
+		for (int i = 0; i < 8; ++i) {
+			block.words[i] |= mask[i];
+		}
+	}
+
+	/*
+	* False: the key was never inserted. True: it probably was.
+	*/
+	inline bool mayContain(const uint64_t hash) const {
+		uint32_t mask[8];
+		makeMask(static_cast<uint32_t>(hash), mask);
+		const Block& block = m_pBlocks[blockIndex(hash)];
+		uint32_t missing = 0;
+		for (int i = 0; i < 8; ++i) {
+			missing |= mask[i] & ~block.words[i];
+		}
+		return missing == 0;
+	}
+
+private:
+	AlprBloomFilter(const AlprBloomFilter&) = delete;
+	AlprBloomFilter& operator=(const AlprBloomFilter&) = delete;
+
+	struct Block {
+		uint32_t words[8];
+	};
+	static_assert(sizeof(Block) == kBlockSize, "unexpected padding");
+
+	void release() {
+		if (m_bOwned) {
+			free(m_pBlocks);
+		}
+		m_pBlocks = nullptr;
+		m_nNumBlocks = 0;
+		m_bOwned = false;
+	}
+
+	inline size_t blockIndex(const uint64_t hash) const {
+		return static_cast<size_t>(((hash >> 32) * m_nNumBlocks) >> 32); // multiply-shift instead of a modulo
+	}
+
+	static inline void makeMask(const uint32_t key, uint32_t mask[8]) {
+		static const uint32_t salts[8] = {
+			0x47b6137bU, 0x44974d91U, 0x8824ad5bU, 0xa2b7289dU, 0x705495c7U, 0x2df1424bU, 0x9efc4947U, 0x5c6bfb31U
+		};
+		for (int i = 0; i < 8; ++i) {
+			mask[i] = 1U << ((key * salts[i]) >> 27);
+		}
+	}
+
+	Block* m_pBlocks;
+	size_t m_nNumBlocks;
+	bool m_bOwned;
+};
+
+#endif /* _ALPR_BLOOM_H_ */
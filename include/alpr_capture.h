@@ -0,0 +1,256 @@
+#if !defined(_ALPR_CAPTURE_H_)
+#define _ALPR_CAPTURE_H_
+
+#include <ultimateALPR-SDK-API-PUBLIC.h>
+#include <alpr_metrics.h>
+#include <opencv2/core.hpp>
+#include <opencv2/videoio.hpp>
+#include <condition_variable>
+#include <cstdlib>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/*
+* Choice of the cv::VideoCapture backend and of its decode settings. Decoding is often a third of
+* the frame time, the fastest backend depends on the camera/container and on the box:
+*	"auto": whatever OpenCV picks (CAP_ANY), default threading
+*	"ffmpeg": FFmpeg with 'threads' decoder threads (0: FFmpeg's default) and, with 'hwaccel', any
+*		hardware decoder FFmpeg supports (OpenCV 4.5.2+)
+*	"gstreamer": the source is a GStreamer pipeline ending with an appsink, e.g. with nvv4l2decoder on
+*		Jetson. A plain file path is wrapped in "filesrc ! decodebin ! videoconvert ! appsink".
+*	"v4l2": the source is a device (/dev/videoN or its index), streamed through mmap'ed buffers
+*		('buffers' of them) with the pixel format 'fourcc' (e.g. MJPG, YUYV) and the requested size/fps
+*/
+struct AlprCaptureOptions {
+	std::string backend = "auto";
+	int threads = 0;
+	bool hwaccel = false;
+	std::string fourcc;
+	int buffers = 0;
+	int width = 0;
+	int height = 0;
+	double fps = 0.0;
+};
+
+/*
+* --capture, --capture_threads, --capture_hwaccel, --capture_fourcc, --capture_buffers, --capture_width,
+* --capture_height, --capture_fps
+*/
+static AlprCaptureOptions alprCaptureParseArgs(std::map<std::string, std::string >& args)
+{
+	AlprCaptureOptions options;
+	if (args.find("--capture") != args.end()) {
+		options.backend = args["--capture"];
+	}
+	if (args.find("--capture_threads") != args.end()) {
+		options.threads = std::atoi(args["--capture_threads"].c_str());
+	}
+	if (args.find("--capture_hwaccel") != args.end()) {
+		options.hwaccel = (args["--capture_hwaccel"].compare("true") == 0);
+	}
+	if (args.find("--capture_fourcc") != args.end()) {
+		options.fourcc = args["--capture_fourcc"];
+	}
+	if (args.find("--capture_buffers") != args.end()) {
+		options.buffers = std::atoi(args["--capture_buffers"].c_str());
+	}
+	if (args.find("--capture_width") != args.end()) {
+		options.width = std::atoi(args["--capture_width"].c_str());
+	}
+	if (args.find("--capture_height") != args.end()) {
+		options.height = std::atoi(args["--capture_height"].c_str());
+	}
+	if (args.find("--capture_fps") != args.end()) {
+		options.fps = std::atof(args["--capture_fps"].c_str());
+	}
+	return options;
+}
+
+static bool alprCaptureOpen(cv::VideoCapture& cap, const std::string& source, const AlprCaptureOptions& options)
+{
+	if (options.backend == "auto") {
+		cap.open(source);
+	}
+	else if (options.backend == "ffmpeg") {
+		// Read by the FFmpeg backend when opening ("key;value|key;value" AVDictionary entries), restored right after
+		const char* previous = getenv("OPENCV_FFMPEG_CAPTURE_OPTIONS");
+		const bool hadPrevious = (previous != nullptr);
+		const std::string saved = hadPrevious ? previous : "";
+		if (options.threads > 0) {
+			setenv("OPENCV_FFMPEG_CAPTURE_OPTIONS", ("threads;" + std::to_string(options.threads)).c_str(), 1);
+		}
+#if (CV_VERSION_MAJOR * 10000 + CV_VERSION_MINOR * 100 + CV_VERSION_REVISION) >= 40502
+		cap.open(source, cv::CAP_FFMPEG, std::vector<int>{
+			cv::CAP_PROP_HW_ACCELERATION, options.hwaccel ? cv::VIDEO_ACCELERATION_ANY : cv::VIDEO_ACCELERATION_NONE });
+#else
+		if (options.hwaccel) {
+			ULTALPR_SDK_PRINT_WARN("Hardware decoding needs OpenCV 4.5.2+, using software decoding");
+		}
+		cap.open(source, cv::CAP_FFMPEG);
+#endif
+		if (options.threads > 0) {
+			if (hadPrevious) {
+				setenv("OPENCV_FFMPEG_CAPTURE_OPTIONS", saved.c_str(), 1);
+			}
+			else {
+				unsetenv("OPENCV_FFMPEG_CAPTURE_OPTIONS");
+			}
+		}
+	}
+	else if (options.backend == "gstreamer") {
+		const std::string pipeline = (source.find('!') != std::string::npos) ? source
+			: ("filesrc location=\"" + source + "\" ! decodebin ! videoconvert ! video/x-raw,format=BGR ! appsink sync=false");
+		cap.open(pipeline, cv::CAP_GSTREAMER);
+	}
+	else if (options.backend == "v4l2") {
+		const bool isIndex = !source.empty() && source.find_first_not_of("0123456789") == std::string::npos;
+		if (isIndex) {
+			cap.open(std::atoi(source.c_str()), cv::CAP_V4L2);
+		}
+		else {
+			cap.open(source, cv::CAP_V4L2);
+		}
+		if (cap.isOpened()) {
+			// The pixel format must be set before the size, the driver may adjust the size to the format
+			if (options.fourcc.size() == 4) {
+				cap.set(cv::CAP_PROP_FOURCC, cv::VideoWriter::fourcc(options.fourcc[0], options.fourcc[1], options.fourcc[2], options.fourcc[3]));
+			}
+			if (options.width > 0 && options.height > 0) {
+				cap.set(cv::CAP_PROP_FRAME_WIDTH, options.width);
+				cap.set(cv::CAP_PROP_FRAME_HEIGHT, options.height);
+			}
+			if (options.fps > 0) {
+				cap.set(cv::CAP_PROP_FPS, options.fps);
+			}
+			if (options.buffers > 0) {
+				cap.set(cv::CAP_PROP_BUFFERSIZE, options.buffers); // number of mmap'ed driver buffers
+			}
+		}
+	}
+	else {
+		ULTALPR_SDK_PRINT_ERROR("Unknown capture backend: %s", options.backend.c_str());
+		return false;
+	}
+	if (!cap.isOpened()) {
+		ULTALPR_SDK_PRINT_ERROR("Failed to open %s with the %s capture backend", source.c_str(), options.backend.c_str());
+		return false;
+	}
+	return true;
+}
+
+/*
+* Reads a cv::VideoCapture on its own thread and keeps only the newest frame, stamped when it was read.
+* While the engine is slow the frames in between are overwritten (shed) instead of queuing up in the decoder,
+* and the frame handed over is as old as the time it waited, which is what --max_age_ms compares.
+* Files have no clock of their own: they are paced with their timestamps (CAP_PROP_POS_MSEC), as a camera would
+* deliver them.
+*/
+class AlprFrameGrabber {
+public:
+	AlprFrameGrabber() : m_pCap(nullptr), m_bFresh(false), m_bEnded(false), m_bStop(false), m_nOverwritten(0) {}
+	~AlprFrameGrabber() {
+		stop();
+	}
+
+	void start(cv::VideoCapture& cap) {
+		stop();
+		m_pCap = &cap;
+		m_bFresh = m_bEnded = m_bStop = false;
+		const bool isFile = cap.get(cv::CAP_PROP_FRAME_COUNT) > 0;
+		m_Thread = std::thread([this, isFile]() { run(isFile); });
+	}
+
+	inline bool running() const { return m_Thread.joinable(); }
+
+	/*
+	* Blocks until a frame newer than the previous one is read, returns false at the end of the stream
+	*/
+	bool next(cv::Mat& frame, AlprClock::time_point& readAt) {
+		std::unique_lock<std::mutex> lock(m_Mutex);
+		m_Changed.wait(lock, [this] { return m_bFresh || m_bEnded; });
+		if (!m_bFresh) {
+			return false;
+		}
+		frame = m_Frame; // the buffer is handed over, the grabber reads into another one
+		m_Frame = cv::Mat();
+		readAt = m_ReadAt;
+		m_bFresh = false;
+		return true;
+	}
+
+	// Frames overwritten before being taken since the previous call
+	uint64_t takeOverwritten() {
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		const uint64_t count = m_nOverwritten;
+		m_nOverwritten = 0;
+		return count;
+	}
+
+	void stop() {
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			m_bStop = true;
+		}
+		if (m_Thread.joinable()) {
+			m_Thread.join();
+		}
+	}
+
+private:
+	AlprFrameGrabber(const AlprFrameGrabber&) = delete;
+	AlprFrameGrabber& operator=(const AlprFrameGrabber&) = delete;
+
+	void run(const bool isFile) {
+		cv::Mat frame;
+		AlprClock::time_point start;
+		double startMillis = -1.0;
+		while (true) {
+			{
+				std::lock_guard<std::mutex> lock(m_Mutex);
+				if (m_bStop) {
+					break;
+				}
+			}
+			if (!m_pCap->read(frame) || frame.empty()) {
+				break;
+			}
+			if (isFile) {
+				const double millis = m_pCap->get(cv::CAP_PROP_POS_MSEC);
+				if (startMillis < 0.0) {
+					startMillis = millis;
+					start = AlprClock::now();
+				}
+				else if (millis > startMillis) {
+					std::this_thread::sleep_until(start + std::chrono::microseconds(static_cast<int64_t>((millis - startMillis) * 1000.0)));
+				}
+			}
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			if (m_bFresh) {
+				++m_nOverwritten;
+			}
+			std::swap(m_Frame, frame); // 'frame' is now empty or the overwritten one, never a buffer handed over
+			m_ReadAt = AlprClock::now();
+			m_bFresh = true;
+			m_Changed.notify_one();
+		}
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_bEnded = true;
+		m_Changed.notify_one();
+	}
+
+	cv::VideoCapture* m_pCap;
+	std::thread m_Thread;
+	std::mutex m_Mutex;
+	std::condition_variable m_Changed;
+	cv::Mat m_Frame;
+	AlprClock::time_point m_ReadAt;
+	bool m_bFresh;
+	bool m_bEnded;
+	bool m_bStop;
+	uint64_t m_nOverwritten;
+};
+
+#endif /* _ALPR_CAPTURE_H_ */
@@ -0,0 +1,497 @@
+#if !defined(_ALPR_ENGINE_H_)
+#define _ALPR_ENGINE_H_
+
+#include <ultimateALPR-SDK-API-PUBLIC.h>
+#include <alpr_record.h>
+#include <json.hpp> // nlohmann/json
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/stat.h>
+
+using namespace ultimateAlprSdk;
+
+/*
+* Engine abstraction so that everything around the recognizer (voting, watchlist, overlay, I/O)
+* can run without the proprietary SDK:
+*  - "sdk": ultimateALPR through UltAlprSdkEngine, only available when built with ALPR_HAVE_SDK
+*  - "mock": replays recorded results, one per frame, with a synthetic latency
+*/
+
+/*
+* Same content as UltAlprSdkResult, owned by us so that it doesn't need the SDK library
+*/
+struct AlprEngineResult {
+	int code = 0;
+	std::string phrase = "OK";
+	std::string json;
+	size_t numPlates = 0;
+	int64_t frameId = -1; // index of the frame since init(), -1 when unknown
+
+	inline bool isOK() const {
+		return code == 0;
+	}
+	static AlprEngineResult error(const int code, const std::string& phrase) {
+		AlprEngineResult result;
+		result.code = code;
+		result.phrase = phrase;
+		return result;
+	}
+};
+
+/*
+* Parallel delivery. Like the SDK, only results with at least one plate are delivered.
+* More info: https://www.doubango.org/SDKs/anpr/docs/Parallel_versus_sequential_processing.html
+*/
+class AlprEngineCallback {
+public:
+	virtual ~AlprEngineCallback() {}
+	virtual void onNewResult(const AlprEngineResult& result) = 0;
+};
+
+class AlprEngine {
+public:
+	virtual ~AlprEngine() {}
+	virtual const char* name() const = 0;
+
+	/*
+	* @param jsonConfig Full SDK configuration (https://www.doubango.org/SDKs/anpr/docs/Configuration_options.html).
+	*	Backends ignore the entries they don't know.
+	* @param callback Enables the parallel mode when not null
+	*/
+	virtual AlprEngineResult init(const std::string& jsonConfig, AlprEngineCallback* callback = nullptr) = 0;
+	virtual AlprEngineResult deInit() = 0;
+	virtual AlprEngineResult warmUp(const ULTALPR_SDK_IMAGE_TYPE imageType) = 0;
+
+	// Packed formats (RGB24, BGR24, Y...), see UltAlprSdkEngine::process
+	virtual AlprEngineResult process(
+		const ULTALPR_SDK_IMAGE_TYPE imageType,
+		const void* imageData,
+		const size_t imageWidthInSamples,
+		const size_t imageHeightInSamples,
+		const size_t imageStrideInSamples = 0,
+		const int imageExifOrientation = 1
+	) = 0;
+
+	// Planar and semi-planar formats (YUV420P, NV12...), see UltAlprSdkEngine::process
+	virtual AlprEngineResult process(
+		const ULTALPR_SDK_IMAGE_TYPE imageType,
+		const void* yPtr,
+		const void* uPtr,
+		const void* vPtr,
+		const size_t widthInSamples,
+		const size_t heightInSamples,
+		const size_t yStrideInBytes,
+		const size_t uStrideInBytes,
+		const size_t vStrideInBytes,
+		const size_t uvPixelStrideInBytes = 0,
+		const int exifOrientation = 1
+	) = 0;
+};
+
+#if ALPR_HAVE_SDK
+/*
+* ultimateALPR SDK backend. The SDK engine is a process-wide singleton -> only one instance at a time.
+*/
+class AlprSdkEngine : public AlprEngine {
+public:
+	virtual const char* name() const override { return "sdk"; }
+
+	virtual AlprEngineResult init(const std::string& jsonConfig, AlprEngineCallback* callback = nullptr) override {
+		m_Delivery.target = callback;
+		return convert(UltAlprSdkEngine::init(jsonConfig.c_str(), callback ? &m_Delivery : nullptr));
+	}
+	virtual AlprEngineResult deInit() override {
+		return convert(UltAlprSdkEngine::deInit());
+	}
+	virtual AlprEngineResult warmUp(const ULTALPR_SDK_IMAGE_TYPE imageType) override {
+		return convert(UltAlprSdkEngine::warmUp(imageType));
+	}
+	virtual AlprEngineResult process(
+		const ULTALPR_SDK_IMAGE_TYPE imageType, const void* imageData,
+		const size_t imageWidthInSamples, const size_t imageHeightInSamples,
+		const size_t imageStrideInSamples = 0, const int imageExifOrientation = 1) override {
+		return convert(UltAlprSdkEngine::process(imageType, imageData, imageWidthInSamples, imageHeightInSamples, imageStrideInSamples, imageExifOrientation));
+	}
+	virtual AlprEngineResult process(
+		const ULTALPR_SDK_IMAGE_TYPE imageType, const void* yPtr, const void* uPtr, const void* vPtr,
+		const size_t widthInSamples, const size_t heightInSamples,
+		const size_t yStrideInBytes, const size_t uStrideInBytes, const size_t vStrideInBytes,
+		const size_t uvPixelStrideInBytes = 0, const int exifOrientation = 1) override {
+		return convert(UltAlprSdkEngine::process(imageType, yPtr, uPtr, vPtr, widthInSamples, heightInSamples,
+			yStrideInBytes, uStrideInBytes, vStrideInBytes, uvPixelStrideInBytes, exifOrientation));
+	}
+
+	static AlprEngineResult convert(const UltAlprSdkResult& sdkResult) {
+		AlprEngineResult result;
+		result.code = sdkResult.code();
+		result.phrase = sdkResult.phrase() ? sdkResult.phrase() : "";
+		result.json = sdkResult.json() ? sdkResult.json() : "";
+		result.numPlates = sdkResult.numPlates();
+		return result;
+	}
+
+private:
+	struct Delivery : public UltAlprSdkParallelDeliveryCallback {
+		AlprEngineCallback* target = nullptr;
+		virtual void onNewResult(const UltAlprSdkResult* result) const override {
+			ULTALPR_SDK_ASSERT(result != nullptr);
+			if (target) {
+				AlprEngineResult converted = convert(*result);
+				if (!converted.json.empty()) {
+					// Parallel results arrive out of band, the SDK tags them with the frame index
+					const nlohmann::json parsed = nlohmann::json::parse(converted.json, nullptr, false);
+					if (!parsed.is_discarded() && parsed.contains("frame_id")) {
+						converted.frameId = parsed["frame_id"].get<int64_t>();
+					}
+				}
+				target->onNewResult(converted);
+			}
+		}
+	};
+	Delivery m_Delivery;
+};
+#endif /* ALPR_HAVE_SDK */
+
+/*
+* Scripted backend for hardware-free runs. Configuration entries (same JSON as the SDK):
+*	"mock_results_file": JSON Lines file, one line per frame holding what UltAlprSdkResult::json()
+*		returned for that frame ("{}" or an empty line when there was no plate), or a recording
+*		made with main --record (see alpr_record.h). Replayed in a loop.
+*	"mock_latency_ms": synthetic processing time per frame. Default: 0.
+*	"mock_jitter_ms": uniform random jitter added to the latency (fixed seed). Default: 0.
+* The image content is ignored.
+*/
+class AlprMockEngine : public AlprEngine {
+public:
+	AlprMockEngine() : m_nNextFrame(0), m_bRunning(false), m_pCallback(nullptr), m_Random(12345) {}
+	virtual ~AlprMockEngine() {
+		deInit();
+	}
+	virtual const char* name() const override { return "mock"; }
+
+	virtual AlprEngineResult init(const std::string& jsonConfig, AlprEngineCallback* callback = nullptr) override {
+		nlohmann::json config = nlohmann::json::parse(jsonConfig, nullptr, false);
+		if (config.is_discarded()) {
+			return AlprEngineResult::error(-1, "Invalid JSON config");
+		}
+		m_Script.clear();
+		m_nNextFrame = 0;
+		m_dLatencyMillis = config.value("mock_latency_ms", 0.0);
+		m_dJitterMillis = config.value("mock_jitter_ms", 0.0);
+		const std::string path = config.value("mock_results_file", std::string());
+		if (!path.empty() && !load(path)) {
+			return AlprEngineResult::error(-1, "Failed to load " + path);
+		}
+		if (m_Script.empty()) {
+			m_Script.push_back(AlprEngineResult()); // no plate, ever
+		}
+		m_pCallback = callback;
+		if (m_pCallback) {
+			m_bRunning = true;
+			m_Worker = std::thread(&AlprMockEngine::deliver, this);
+		}
+		ULTALPR_SDK_PRINT_INFO("Mock engine: %zu scripted frames, %.2lf+%.2lf ms per frame", m_Script.size(), m_dLatencyMillis, m_dJitterMillis);
+		return AlprEngineResult();
+	}
+
+	virtual AlprEngineResult deInit() override {
+		if (m_Worker.joinable()) {
+			{
+				std::lock_guard<std::mutex> lock(m_Mutex);
+				m_bRunning = false;
+			}
+			m_CondVar.notify_all();
+			m_Worker.join();
+		}
+		m_pCallback = nullptr;
+		return AlprEngineResult();
+	}
+
+	virtual AlprEngineResult warmUp(const ULTALPR_SDK_IMAGE_TYPE imageType) override {
+		++m_nNextFrame; // like the SDK, the warm-up inference takes a frame id
+		return AlprEngineResult();
+	}
+
+	virtual AlprEngineResult process(
+		const ULTALPR_SDK_IMAGE_TYPE imageType, const void* imageData,
+		const size_t imageWidthInSamples, const size_t imageHeightInSamples,
+		const size_t imageStrideInSamples = 0, const int imageExifOrientation = 1) override {
+		return next();
+	}
+	virtual AlprEngineResult process(
+		const ULTALPR_SDK_IMAGE_TYPE imageType, const void* yPtr, const void* uPtr, const void* vPtr,
+		const size_t widthInSamples, const size_t heightInSamples,
+		const size_t yStrideInBytes, const size_t uStrideInBytes, const size_t vStrideInBytes,
+		const size_t uvPixelStrideInBytes = 0, const int exifOrientation = 1) override {
+		return next();
+	}
+
+	// Parses one recorded SDK JSON into a result, "{}" and "" are results without plates
+	static AlprEngineResult fromJson(const std::string& json) {
+		AlprEngineResult result;
+		if (json.empty() || json == "{}") {
+			return result;
+		}
+		const nlohmann::json parsed = nlohmann::json::parse(json, nullptr, false);
+		if (parsed.is_discarded()) {
+			return AlprEngineResult::error(-1, "Invalid recorded JSON");
+		}
+		result.json = json;
+		if (parsed.contains("plates") && parsed["plates"].is_array()) {
+			result.numPlates = parsed["plates"].size();
+		}
+		return result;
+	}
+
+private:
+	bool load(const std::string& path) {
+		if (AlprRecordReader::isRecording(path)) {
+			AlprRecordReader reader;
+			AlprRecordEntry entry;
+			if (!reader.open(path)) {
+				return false;
+			}
+			while (reader.next(entry)) {
+				m_Script.resize(entry.frame); // frames without plates
+				if (entry.json.empty()) {
+					break;
+				}
+				m_Script.push_back(fromJson(entry.json));
+			}
+			return true;
+		}
+		std::ifstream file(path.c_str());
+		if (!file) {
+			ULTALPR_SDK_PRINT_ERROR("Failed to open mock results: %s", path.c_str());
+			return false;
+		}
+		std::string line;
+		while (std::getline(file, line)) {
+			const AlprEngineResult result = fromJson(line);
+			if (!result.isOK()) {
+				ULTALPR_SDK_PRINT_ERROR("%s:%zu: %s", path.c_str(), m_Script.size() + 1, result.phrase.c_str());
+				return false;
+			}
+			m_Script.push_back(result);
+		}
+		return true;
+	}
+
+	std::chrono::microseconds latency() {
+		double millis = m_dLatencyMillis;
+		if (m_dJitterMillis > 0) {
+			millis += std::uniform_real_distribution<double>(0.0, m_dJitterMillis)(m_Random);
+		}
+		return std::chrono::microseconds(static_cast<int64_t>(millis * 1000.0));
+	}
+
+	AlprEngineResult next() {
+		const int64_t frameId = static_cast<int64_t>(m_nNextFrame);
+		const AlprEngineResult& scripted = m_Script[m_nNextFrame++ % m_Script.size()];
+		const std::chrono::microseconds delay = latency();
+		if (!m_pCallback) {
+			if (delay.count() > 0) {
+				std::this_thread::sleep_for(delay);
+			}
+			AlprEngineResult result = scripted;
+			result.frameId = frameId;
+			return result;
+		}
+		// Parallel mode: process() only queues, the worker pays the latency and delivers
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			m_Pending.push_back(Pending{ delay, frameId, &scripted });
+		}
+		m_CondVar.notify_one();
+		return AlprEngineResult();
+	}
+
+	void deliver() {
+		std::unique_lock<std::mutex> lock(m_Mutex);
+		while (true) {
+			m_CondVar.wait(lock, [this] { return !m_bRunning || !m_Pending.empty(); });
+			if (m_Pending.empty()) {
+				return; // stopped and drained
+			}
+			const Pending item = m_Pending.front();
+			m_Pending.pop_front();
+			lock.unlock();
+			if (item.delay.count() > 0) {
+				std::this_thread::sleep_for(item.delay);
+			}
+			if (item.scripted->numPlates) {
+				AlprEngineResult result = *item.scripted;
+				result.frameId = item.frameId;
+				m_pCallback->onNewResult(result);
+			}
+			lock.lock();
+		}
+	}
+
+	std::vector<AlprEngineResult> m_Script;
+	size_t m_nNextFrame;
+	double m_dLatencyMillis = 0.0;
+	double m_dJitterMillis = 0.0;
+
+	struct Pending {
+		std::chrono::microseconds delay;
+		int64_t frameId;
+		const AlprEngineResult* scripted;
+	};
+	bool m_bRunning;
+	AlprEngineCallback* m_pCallback;
+	std::deque<Pending> m_Pending;
+	std::mutex m_Mutex;
+	std::condition_variable m_CondVar;
+	std::thread m_Worker;
+	std::default_random_engine m_Random;
+};
+
+/*
+* Creates a backend by name ("sdk" or "mock"), nullptr if unknown or not built in
+*/
+static AlprEngine* alprEngineCreate(const std::string& name)
+{
+#if ALPR_HAVE_SDK
+	if (name == "sdk") {
+		return new AlprSdkEngine();
+	}
+#endif /* ALPR_HAVE_SDK */
+	if (name == "mock") {
+		return new AlprMockEngine();
+	}
+	ULTALPR_SDK_PRINT_ERROR("Unknown or unavailable engine: %s", name.c_str());
+	return nullptr;
+}
+
+/*
+* init() then warmUp(). With a parallel delivery callback, the warm-up runs on an engine initialized without it,
+* which is then initialized again with it: the warm-up inference takes a frame id (and may deliver its result)
+* while the callers attribute the results by frame id, 0 being the first frame they submit.
+*/
+static AlprEngineResult alprEngineInitWarm(AlprEngine& engine, const std::string& jsonConfig, const ULTALPR_SDK_IMAGE_TYPE imageType, AlprEngineCallback* callback = nullptr)
+{
+	AlprEngineResult result = engine.init(jsonConfig);
+	if (result.isOK()) {
+		result = engine.warmUp(imageType);
+	}
+	if (result.isOK() && callback) {
+		engine.deInit();
+		result = engine.init(jsonConfig, callback);
+	}
+	return result;
+}
+
+static const char* alprEngineDefault()
+{
+#if ALPR_HAVE_SDK
+	return "sdk";
+#else
+	return "mock";
+#endif /* ALPR_HAVE_SDK */
+}
+
+/*
+* JSON config of the engine for the tools (main, enroll, ingest), the only copy of the settings and license token.
+* 'wholePhotos': still images (enrollment, trigger cameras) searched whole with the pyramidal search, instead of the
+* lane ROI of the video camera. From 'args': --assets (default ../assets), --mock_results and --mock_latency_ms.
+*/
+static std::string alprEngineConfig(const std::map<std::string, std::string>& args, const bool wholePhotos)
+{
+	std::string jsonConfig =
+		"{"
+		"\"debug_level\": \"fatal\","
+		"\"debug_write_input_image_enabled\": false,"
+		"\"debug_internal_data_path\": \".\","
+		""
+		"\"num_threads\": -1,"
+		"\"gpgpu_enabled\": true,"
+		""
+		"\"klass_vcr_gamma\": 1.5,"
+		"";
+	jsonConfig += wholePhotos ? "" : "\"detect_roi\": [600, 1200, 0, 600],";
+	jsonConfig +=
+		"\"detect_minscore\": 0.1,"
+		"";
+	jsonConfig += std::string("\"pyramidal_search_enabled\": ") + (wholePhotos ? "true," : "false,");
+	jsonConfig +=
+		"\"pyramidal_search_sensitivity\": 0.28,"
+		"\"pyramidal_search_minscore\": 0.3,"
+		"\"pyramidal_search_min_image_size_inpixels\": 800,"
+		""
+		"\"recogn_minscore\": 0.3,"
+		"\"recogn_score_type\": \"min\","
+		""
+		"\"license_token_data\": \"ANI6+wXQBUVDUFFVdzBBR1VQRkMuBApERW4nS1FTRkgvKTEAGTwQeEtZREJUdkdVV3tGCWl3akZOXFg4G3Q2Ymk7cUFYWygGCBQqDgZVSUUzPW5LaUUxRlUpImJcRkFkMRscJyQ6RlhxRTxODAtKNTE3MGRlRDFdVGZqVDc1fScXNH5IX1AlCzkjKRdRNUVbXGYMLz0/JigQBg5gVmNiW3oxeUtxCFU6I1J6WDUyXiEyGhlSQz0/QxgpJzIqXyxXV35eaDBRJ059aHAVPhk5P2N6LzoeVls=\""
+		"";
+	std::map<std::string, std::string>::const_iterator it = args.find("--assets");
+	jsonConfig += std::string(",\"assets_folder\": \"") + (it != args.end() ? it->second : std::string("../assets")) + std::string("\"");
+	if ((it = args.find("--mock_results")) != args.end()) {
+		jsonConfig += std::string(",\"mock_results_file\": \"") + it->second + std::string("\"");
+	}
+	if ((it = args.find("--mock_latency_ms")) != args.end()) {
+		jsonConfig += std::string(",\"mock_latency_ms\": ") + std::to_string(std::atof(it->second.c_str()));
+	}
+	jsonConfig += "}"; // end-of-config
+	return jsonConfig;
+}
+
+/*
+* Inference backend of the SDK, applied on top of a JSON config:
+*	cpu: TensorFlow on the CPU
+*	openvino: OpenVINO (x86) on 'openvinoDevice' (CPU, GPU, MYRIAD...), models from models.openvino
+*	tensorrt: TensorRT on the GPU (Jetson), plans from models.tensorrt (see alpr_trt.h)
+*	auto: the config as it is
+* Returns an empty string when the backend is unknown.
+*/
+static std::string alprEngineBackendConfig(const std::string& jsonConfig, const std::string& backend, const std::string& openvinoDevice = "CPU")
+{
+	if (backend == "auto") {
+		return jsonConfig;
+	}
+	if (backend != "cpu" && backend != "openvino" && backend != "tensorrt") {
+		return std::string();
+	}
+	nlohmann::json config = nlohmann::json::parse(jsonConfig);
+	config["gpgpu_enabled"] = (backend == "tensorrt");
+	config["openvino_enabled"] = (backend == "openvino");
+	if (backend == "openvino") {
+		config["openvino_device"] = openvinoDevice;
+	}
+	return config.dump();
+}
+
+/*
+* Whether 'backend' can run on this host with the models in 'assetsFolder'
+*/
+static bool alprEngineBackendAvailable(const std::string& backend, const std::string& assetsFolder)
+{
+	struct stat st;
+	if (backend == "openvino") {
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__)
+		return stat((assetsFolder + "/models.openvino").c_str(), &st) == 0;
+#else
+		return false;
+#endif
+	}
+	if (backend == "tensorrt") {
+#if defined(__aarch64__)
+		return stat((assetsFolder + "/models.tensorrt").c_str(), &st) == 0 && stat("/etc/nv_tegra_release", &st) == 0;
+#else
+		return false;
+#endif
+	}
+	return backend == "cpu" || backend == "auto";
+}
+
+#endif /* _ALPR_ENGINE_H_ */
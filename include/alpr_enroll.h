@@ -0,0 +1,147 @@
+#if !defined(_ALPR_ENROLL_H_)
+#define _ALPR_ENROLL_H_
+
+#include <ultimateALPR-SDK-API-PUBLIC.h>
+#include <alpr_watchlist.h>
+#include <alpr_metrics.h>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <unordered_set>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+/*
+* Appends newly enrolled plates to a text watchlist (registered.txt).
+* Idempotent: the plates already in the file are loaded at open() and never written again, so
+* several passes of the same car or several runs over the same footage add each plate once.
+* Plates are buffered and written in batches, each batch with a single write() on an O_APPEND
+* descriptor followed by fsync(): a crash loses at most the pending batch, never half a line.
+* A batch that fails part way (disk full...) is truncated off the file and kept pending for the next flush().
+* A batch is written when it has 'batchSize' plates, when the oldest one waited 'maxDelaySeconds',
+* and by flush()/close().
+*/
+class AlprEnrollmentWriter {
+public:
+	AlprEnrollmentWriter(const size_t batchSize = 64, const double maxDelaySeconds = 5.0)
+		: m_nFd(-1), m_nBatchSize(batchSize ? batchSize : 1), m_nMaxDelayMicros(static_cast<uint64_t>(maxDelaySeconds * 1e6)), m_nNumPending(0), m_nNumWritten(0) {}
+	~AlprEnrollmentWriter() {
+		close();
+	}
+
+	bool open(const std::string& path) {
+		close();
+		m_Known.clear();
+		bool needsNewline = false;
+		std::ifstream existing(path.c_str(), std::ios::binary);
+		if (existing) {
+			std::string buff;
+			AlprWatchlistRecord record;
+			while (existing >> buff) {
+				if (alprWatchlistParseRecord(buff, record)) {
+					m_Known.insert(record.plate);
+				}
+			}
+			existing.clear();
+			existing.seekg(0, std::ios::end);
+			if (existing.tellg() > 0) {
+				existing.seekg(-1, std::ios::end);
+				needsNewline = (existing.get() != '\n');
+			}
+		}
+		m_nFd = ::open(path.c_str(), O_WRONLY | O_APPEND | O_CREAT, 0644);
+		if (m_nFd < 0) {
+			ULTALPR_SDK_PRINT_ERROR("Failed to open %s for enrollment: %s", path.c_str(), strerror(errno));
+			return false;
+		}
+		m_strPath = path;
+		m_strPending = needsNewline ? "\n" : "";
+		ULTALPR_SDK_PRINT_INFO("Enrolling into %s, %zu plates already registered", path.c_str(), m_Known.size());
+		return true;
+	}
+
+	/*
+	* Returns false when the plate is already registered. 'plate' is expected to be normalized.
+	*/
+	bool add(const std::string& plate) {
+		if (!m_Known.insert(plate).second) {
+			return false;
+		}
+		if (!m_nNumPending) {
+			m_OldestPending = AlprClock::now();
+		}
+		m_strPending += plate + "\n";
+		if (++m_nNumPending >= m_nBatchSize) {
+			flush();
+		}
+		return true;
+	}
+
+	// Writes the pending batch when it has been waiting for too long, to be called regularly (e.g. once per frame)
+	inline void tick() {
+		if (m_nNumPending && alprMicrosSince(m_OldestPending) >= m_nMaxDelayMicros) {
+			flush();
+		}
+	}
+
+	bool flush() {
+		if (m_nFd < 0 || !m_nNumPending) {
+			return true;
+		}
+		struct stat st;
+		const off_t batchStart = (fstat(m_nFd, &st) == 0) ? st.st_size : -1;
+		size_t offset = 0;
+		while (offset < m_strPending.size()) {
+			const ssize_t count = ::write(m_nFd, m_strPending.data() + offset, m_strPending.size() - offset);
+			if (count < 0 && errno == EINTR) {
+				continue;
+			}
+			if (count <= 0) {
+				ULTALPR_SDK_PRINT_ERROR("Failed to write %s: %s", m_strPath.c_str(), strerror(errno));
+				// Part of the batch may be in the file: cut it back to where the batch started so the next flush()
+				// rewrites it whole, or when that fails resume after the bytes already written (no line twice)
+				if (offset && (batchStart < 0 || ftruncate(m_nFd, batchStart) != 0)) {
+					m_strPending.erase(0, offset);
+				}
+				return false;
+			}
+			offset += static_cast<size_t>(count);
+		}
+		if (fsync(m_nFd) != 0) {
+			ULTALPR_SDK_PRINT_WARN("fsync(%s) failed: %s", m_strPath.c_str(), strerror(errno));
+		}
+		m_nNumWritten += m_nNumPending;
+		m_nNumPending = 0;
+		m_strPending.clear();
+		return true;
+	}
+
+	void close() {
+		if (m_nFd >= 0) {
+			flush();
+			::close(m_nFd);
+			m_nFd = -1;
+		}
+	}
+
+	inline size_t numWritten() const { return m_nNumWritten; }
+	inline size_t numKnown() const { return m_Known.size(); }
+
+private:
+	AlprEnrollmentWriter(const AlprEnrollmentWriter&) = delete;
+	AlprEnrollmentWriter& operator=(const AlprEnrollmentWriter&) = delete;
+
+	int m_nFd;
+	std::string m_strPath;
+	size_t m_nBatchSize;
+	uint64_t m_nMaxDelayMicros;
+	std::unordered_set<std::string> m_Known;
+	std::string m_strPending;
+	size_t m_nNumPending;
+	size_t m_nNumWritten;
+	AlprClock::time_point m_OldestPending;
+};
+
+#endif /* _ALPR_ENROLL_H_ */
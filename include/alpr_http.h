@@ -0,0 +1,205 @@
+#if !defined(_ALPR_HTTP_H_)
+#define _ALPR_HTTP_H_
+
+#include <ultimateALPR-SDK-API-PUBLIC.h>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+/*
+* Minimal HTTP/1.0 server bound to 127.0.0.1, used to expose the metrics and the preview on the
+* local host. One background thread, one request per connection, GET only. Streaming responses
+* get their own thread. Not meant to face a network.
+*/
+struct AlprHttpResponse {
+	int status = 200;
+	std::string contentType = "text/plain; charset=utf-8";
+	std::string body;
+	// When set, 'body' is ignored and the function writes to the socket until it returns.
+	// It must return soon after 'running' turns false.
+	std::function<void(int fd, const std::atomic<bool>& running)> stream;
+};
+
+// Returns false when the path is unknown (-> 404)
+typedef std::function<bool(const std::string& path, AlprHttpResponse& response)> AlprHttpHandler;
+
+class AlprHttpServer {
+public:
+	AlprHttpServer() : m_nFd(-1), m_bRunning(false) {}
+	~AlprHttpServer() {
+		stop();
+	}
+
+	bool start(const unsigned short port, const AlprHttpHandler& handler) {
+		m_nFd = socket(AF_INET, SOCK_STREAM, 0);
+		if (m_nFd < 0) {
+			ULTALPR_SDK_PRINT_ERROR("socket() failed: %s", strerror(errno));
+			return false;
+		}
+		const int yes = 1;
+		setsockopt(m_nFd, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+		sockaddr_in addr;
+		memset(&addr, 0, sizeof(addr));
+		addr.sin_family = AF_INET;
+		addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+		addr.sin_port = htons(port);
+		if (bind(m_nFd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 || listen(m_nFd, 8) != 0) {
+			ULTALPR_SDK_PRINT_ERROR("Failed to listen on 127.0.0.1:%u: %s", port, strerror(errno));
+			close(m_nFd);
+			m_nFd = -1;
+			return false;
+		}
+		m_Handler = handler;
+		m_bRunning = true;
+		m_Thread = std::thread(&AlprHttpServer::run, this);
+		ULTALPR_SDK_PRINT_INFO("Listening on http://127.0.0.1:%u", port);
+		return true;
+	}
+
+	void stop() {
+		m_bRunning = false;
+		if (m_Thread.joinable()) {
+			m_Thread.join();
+		}
+		for (Stream& stream : m_Streams) {
+			stream.thread.join();
+		}
+		m_Streams.clear();
+		if (m_nFd >= 0) {
+			close(m_nFd);
+			m_nFd = -1;
+		}
+	}
+
+private:
+	void run() {
+		pollfd pfd;
+		pfd.fd = m_nFd;
+		pfd.events = POLLIN;
+		while (m_bRunning) {
+			// Wake up regularly to check whether we've been stopped
+			if (poll(&pfd, 1, 200) <= 0) {
+				continue;
+			}
+			const int client = accept(m_nFd, nullptr, nullptr);
+			if (client < 0) {
+				continue;
+			}
+			if (!serve(client)) {
+				close(client);
+			}
+		}
+	}
+
+	// Returns true when a streaming thread took the ownership of the socket
+	bool serve(const int client) {
+		const timeval timeout = { 2, 0 };
+		setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+		char request[2048];
+		const ssize_t size = recv(client, request, sizeof(request) - 1, 0);
+		if (size <= 0) {
+			return false;
+		}
+		request[size] = '\0';
+
+		// "GET /path HTTP/1.1"
+		AlprHttpResponse response;
+		std::string path;
+		if (strncmp(request, "GET ", 4) == 0) {
+			const char* end = strchr(request + 4, ' ');
+			path.assign(request + 4, end ? static_cast<size_t>(end - (request + 4)) : strlen(request + 4));
+			if (!m_Handler(path, response)) {
+				response.status = 404;
+				response.body = "not found\n";
+			}
+		}
+		else {
+			response.status = 405;
+			response.body = "method not allowed\n";
+		}
+
+		if (response.stream && response.status == 200) {
+			// Join the finished streams, cap the number of live ones
+			for (size_t i = 0; i < m_Streams.size(); ) {
+				if (*m_Streams[i].done) {
+					m_Streams[i].thread.join();
+					m_Streams.erase(m_Streams.begin() + i);
+				}
+				else {
+					++i;
+				}
+			}
+			if (m_Streams.size() >= kMaxStreams) {
+				response.stream = nullptr;
+				response.status = 503;
+				response.body = "too many streams\n";
+			}
+		}
+		if (response.stream && response.status == 200) {
+			const std::string reply = "HTTP/1.0 200 OK\r\n"
+				"Content-Type: " + response.contentType + "\r\n"
+				"Cache-Control: no-cache\r\n"
+				"Connection: close\r\n\r\n";
+			if (!sendAll(client, reply.data(), reply.size())) {
+				return false;
+			}
+			const std::function<void(int, const std::atomic<bool>&)> stream = response.stream;
+			const std::shared_ptr<std::atomic<bool> > done = std::make_shared<std::atomic<bool> >(false);
+			m_Streams.push_back(Stream());
+			m_Streams.back().done = done;
+			m_Streams.back().thread = std::thread([this, stream, client, done] {
+				stream(client, m_bRunning);
+				close(client);
+				*done = true;
+			});
+			return true;
+		}
+
+		std::string reply = "HTTP/1.0 " + std::to_string(response.status) + (response.status == 200 ? " OK" : " Error") + "\r\n"
+			"Content-Type: " + response.contentType + "\r\n"
+			"Content-Length: " + std::to_string(response.body.size()) + "\r\n"
+			"Connection: close\r\n\r\n" + response.body;
+		sendAll(client, reply.data(), reply.size());
+		return false;
+	}
+
+public:
+	static bool sendAll(const int fd, const char* data, size_t size) {
+		while (size) {
+			const ssize_t sent = send(fd, data, size, MSG_NOSIGNAL);
+			if (sent <= 0) {
+				return false;
+			}
+			data += sent;
+			size -= static_cast<size_t>(sent);
+		}
+		return true;
+	}
+
+private:
+	static const size_t kMaxStreams = 4;
+	struct Stream {
+		std::thread thread;
+		std::shared_ptr<std::atomic<bool> > done;
+	};
+
+	int m_nFd;
+	std::atomic<bool> m_bRunning;
+	std::thread m_Thread;
+	std::vector<Stream> m_Streams;
+	AlprHttpHandler m_Handler;
+};
+
+#endif /* _ALPR_HTTP_H_ */
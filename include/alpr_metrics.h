@@ -0,0 +1,395 @@
+#if !defined(_ALPR_METRICS_H_)
+#define _ALPR_METRICS_H_
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+/*
+* Pipeline instrumentation: latency histograms and counters, exported as Prometheus text
+* or as a one-line summary.
+*
+* Recording a sample never takes a lock: every histogram is split in shards, each thread
+* writes to its own shard with relaxed atomics and the reader sums the shards when it
+* needs a snapshot. The mutex is only used to register new metrics at startup.
+*/
+
+typedef std::chrono::steady_clock AlprClock;
+
+static inline uint64_t alprMicrosSince(const AlprClock::time_point& start, const AlprClock::time_point& end = AlprClock::now())
+{
+	const int64_t micros = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+	return micros > 0 ? static_cast<uint64_t>(micros) : 0;
+}
+
+/*
+* Small integer identifying the calling thread, used to pick a histogram shard
+*/
+static inline unsigned alprThreadSlot()
+{
+	static std::atomic<unsigned> nextSlot(0);
+	static thread_local unsigned slot = nextSlot.fetch_add(1, std::memory_order_relaxed);
+	return slot;
+}
+
+/*
+* Log-linear (HDR-style) bucketing of microsecond values: 16 linear sub-buckets per power
+* of two, i.e. ~6% relative precision, from 1us up to ~71 minutes. Anything above lands in
+* the last bucket.
+*/
+struct AlprHistogramLayout {
+	static const unsigned kSubBucketBits = 4;
+	static const unsigned kSubBuckets = 1u << kSubBucketBits;
+	static const unsigned kMaxBits = 32;
+	static const unsigned kNumBuckets = (kMaxBits - kSubBucketBits + 1) * kSubBuckets;
+
+	static inline unsigned index(uint64_t value) {
+		if (value < kSubBuckets) {
+			return static_cast<unsigned>(value);
+		}
+		if (value >= (1ull << kMaxBits)) {
+			return kNumBuckets - 1;
+		}
+		const unsigned msb = 63 - static_cast<unsigned>(__builtin_clzll(value));
+		const unsigned shift = msb - kSubBucketBits;
+		return ((shift + 1) << kSubBucketBits) + static_cast<unsigned>((value >> shift) & (kSubBuckets - 1));
+	}
+
+	// Highest value mapped to the bucket
+	static inline uint64_t upperBound(unsigned index) {
+		if (index < kSubBuckets) {
+			return index;
+		}
+		const unsigned shift = (index >> kSubBucketBits) - 1;
+		const uint64_t base = (static_cast<uint64_t>(kSubBuckets) + (index & (kSubBuckets - 1))) << shift;
+		return base + ((1ull << shift) - 1);
+	}
+};
+
+struct AlprHistogramSnapshot {
+	std::vector<uint64_t> counts;
+	uint64_t count = 0;
+	uint64_t sum = 0;
+	uint64_t max = 0;
+
+	// Value (in micros) below which 'q' of the samples fall
+	uint64_t quantile(double q) const {
+		if (!count) {
+			return 0;
+		}
+		const uint64_t rank = static_cast<uint64_t>(std::ceil(q * count));
+		uint64_t seen = 0;
+		for (unsigned i = 0; i < counts.size(); ++i) {
+			seen += counts[i];
+			if (seen >= rank && seen) {
+				const uint64_t bound = AlprHistogramLayout::upperBound(i);
+				return bound < max ? bound : max;
+			}
+		}
+		return max;
+	}
+	double mean() const {
+		return count ? static_cast<double>(sum) / count : 0.0;
+	}
+};
+
+class AlprHistogram {
+public:
+	static const unsigned kNumShards = 8;
+
+	AlprHistogram(const std::string& name, const std::string& labels)
+		: m_strName(name), m_strLabels(labels) {
+		for (unsigned s = 0; s < kNumShards; ++s) {
+			m_Shards[s].count = 0;
+			m_Shards[s].sum = 0;
+			m_Shards[s].max = 0;
+			for (unsigned i = 0; i < AlprHistogramLayout::kNumBuckets; ++i) {
+				m_Shards[s].counts[i] = 0;
+			}
+		}
+	}
+
+	inline void record(uint64_t micros) {
+		Shard& shard = m_Shards[alprThreadSlot() % kNumShards];
+		shard.counts[AlprHistogramLayout::index(micros)].fetch_add(1, std::memory_order_relaxed);
+		shard.count.fetch_add(1, std::memory_order_relaxed);
+		shard.sum.fetch_add(micros, std::memory_order_relaxed);
+		uint64_t prev = shard.max.load(std::memory_order_relaxed);
+		while (micros > prev && !shard.max.compare_exchange_weak(prev, micros, std::memory_order_relaxed)) { }
+	}
+	inline void recordSince(const AlprClock::time_point& start) {
+		record(alprMicrosSince(start));
+	}
+
+	AlprHistogramSnapshot snapshot() const {
+		AlprHistogramSnapshot snap;
+		snap.counts.assign(AlprHistogramLayout::kNumBuckets, 0);
+		for (unsigned s = 0; s < kNumShards; ++s) {
+			const Shard& shard = m_Shards[s];
+			for (unsigned i = 0; i < AlprHistogramLayout::kNumBuckets; ++i) {
+				snap.counts[i] += shard.counts[i].load(std::memory_order_relaxed);
+			}
+			snap.sum += shard.sum.load(std::memory_order_relaxed);
+			const uint64_t max = shard.max.load(std::memory_order_relaxed);
+			snap.max = max > snap.max ? max : snap.max;
+		}
+		// Use the bucket total rather than the shard counters so that quantiles stay consistent
+		for (unsigned i = 0; i < AlprHistogramLayout::kNumBuckets; ++i) {
+			snap.count += snap.counts[i];
+		}
+		return snap;
+	}
+
+	inline const std::string& name() const { return m_strName; }
+	inline const std::string& labels() const { return m_strLabels; }
+
+private:
+	// One shard per writer thread, padded so that two writers never share a cache line
+	struct Shard {
+		std::atomic<uint64_t> counts[AlprHistogramLayout::kNumBuckets];
+		std::atomic<uint64_t> count;
+		std::atomic<uint64_t> sum;
+		std::atomic<uint64_t> max;
+		char padding[64];
+	};
+	Shard m_Shards[kNumShards];
+	std::string m_strName;
+	std::string m_strLabels;
+};
+
+class AlprCounter {
+public:
+	AlprCounter(const std::string& name, const std::string& labels)
+		: m_Value(0), m_strName(name), m_strLabels(labels) {}
+
+	inline void add(uint64_t value = 1) {
+		m_Value.fetch_add(value, std::memory_order_relaxed);
+	}
+	inline uint64_t value() const {
+		return m_Value.load(std::memory_order_relaxed);
+	}
+	inline const std::string& name() const { return m_strName; }
+	inline const std::string& labels() const { return m_strLabels; }
+
+private:
+	std::atomic<uint64_t> m_Value;
+	std::string m_strName;
+	std::string m_strLabels;
+};
+
+/*
+* Process-wide registry. Metrics are created once (usually at startup) and live until exit,
+* callers keep the returned reference and record into it directly.
+*/
+class AlprMetrics {
+public:
+	static AlprMetrics& instance() {
+		static AlprMetrics metrics;
+		return metrics;
+	}
+
+	/*
+	* @param name Prometheus family name, in seconds by convention (e.g. alpr_stage_latency_seconds)
+	* @param labels Prometheus labels without the braces (e.g. stage="capture"), may be empty
+	*/
+	AlprHistogram& histogram(const std::string& name, const std::string& labels = "", const std::string& help = "") {
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		for (auto& h : m_Histograms) {
+			if (h->name() == name && h->labels() == labels) {
+				return *h;
+			}
+		}
+		m_Histograms.push_back(std::unique_ptr<AlprHistogram>(new AlprHistogram(name, labels)));
+		addHelp(name, "summary", help);
+		return *m_Histograms.back();
+	}
+
+	AlprCounter& counter(const std::string& name, const std::string& labels = "", const std::string& help = "") {
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		for (auto& c : m_Counters) {
+			if (c->name() == name && c->labels() == labels) {
+				return *c;
+			}
+		}
+		m_Counters.push_back(std::unique_ptr<AlprCounter>(new AlprCounter(name, labels)));
+		addHelp(name, "counter", help);
+		return *m_Counters.back();
+	}
+
+	/*
+	* Prometheus text exposition format (version 0.0.4). Histograms are exported as summaries
+	* (quantiles computed here) to keep the scrape small.
+	*/
+	std::string prometheus() const {
+		static const double quantiles[] = { 0.5, 0.9, 0.99, 0.999 };
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		std::ostringstream out;
+		for (const Family& family : m_Families) {
+			out << "# HELP " << family.name << " " << family.help << "\n";
+			out << "# TYPE " << family.name << " " << family.type << "\n";
+			for (const auto& h : m_Histograms) {
+				if (h->name() != family.name) {
+					continue;
+				}
+				const AlprHistogramSnapshot snap = h->snapshot();
+				const std::string sep = h->labels().empty() ? "" : ",";
+				for (const double q : quantiles) {
+					out << h->name() << "{" << h->labels() << sep << "quantile=\"" << q << "\"} " << snap.quantile(q) * 1e-6 << "\n";
+				}
+				out << h->name() << "_sum" << braces(h->labels()) << " " << snap.sum * 1e-6 << "\n";
+				out << h->name() << "_count" << braces(h->labels()) << " " << snap.count << "\n";
+			}
+			for (const auto& c : m_Counters) {
+				if (c->name() == family.name) {
+					out << c->name() << braces(c->labels()) << " " << c->value() << "\n";
+				}
+			}
+		}
+		return out.str();
+	}
+
+	/*
+	* One line for the logs: "<labels or name> p50/p99/max ms" for every histogram with samples
+	* and the value of every counter
+	*/
+	std::string statsLine() const {
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		std::ostringstream out;
+		out.setf(std::ios::fixed);
+		out.precision(1);
+		for (const auto& h : m_Histograms) {
+			const AlprHistogramSnapshot snap = h->snapshot();
+			if (!snap.count) {
+				continue;
+			}
+			out << (h->labels().empty() ? h->name() : h->labels()) << " "
+				<< snap.quantile(0.5) / 1000.0 << "/" << snap.quantile(0.99) / 1000.0 << "/" << snap.max / 1000.0 << "ms ";
+		}
+		for (const auto& c : m_Counters) {
+			out << (c->labels().empty() ? c->name() : c->name() + "{" + c->labels() + "}") << "=" << c->value() << " ";
+		}
+		return out.str();
+	}
+
+private:
+	AlprMetrics() {}
+	AlprMetrics(const AlprMetrics&) = delete;
+	AlprMetrics& operator=(const AlprMetrics&) = delete;
+
+	struct Family {
+		std::string name;
+		std::string type;
+		std::string help;
+	};
+
+	void addHelp(const std::string& name, const std::string& type, const std::string& help) {
+		for (const Family& family : m_Families) {
+			if (family.name == name) {
+				return;
+			}
+		}
+		m_Families.push_back({ name, type, help.empty() ? name : help });
+	}
+	static std::string braces(const std::string& labels) {
+		return labels.empty() ? labels : "{" + labels + "}";
+	}
+
+	mutable std::mutex m_Mutex;
+	std::vector<Family> m_Families;
+	std::vector<std::unique_ptr<AlprHistogram> > m_Histograms;
+	std::vector<std::unique_ptr<AlprCounter> > m_Counters;
+};
+
+/*
+* Startup timeline of a live run: when each phase ended (engine init, warm-up, capture open,
+* first frame, first result...), measured from the construction of the profile, and when the
+* engine reached its steady state.
+* Steady state: the last 'window' process() times are all within 'tolerance' of their median,
+* i.e. no more lazy loading or cache filling in the engine. The phases are also exported as
+* alpr_startup_seconds{phase="..."}.
+*/
+class AlprStartupProfile {
+public:
+	AlprStartupProfile(const size_t window = 30, const double tolerance = 0.25)
+		: m_Start(AlprClock::now()), m_nWindow(window ? window : 1), m_fTolerance(tolerance), m_nNumProcessed(0), m_nSteadyFrame(0), m_bSteady(false) {}
+
+	// Thread-safe, phases overlap when the capture is opened while the engine loads
+	void mark(const std::string& phase) {
+		const uint64_t micros = alprMicrosSince(m_Start);
+		AlprMetrics::instance().histogram("alpr_startup_seconds", "phase=\"" + phase + "\"", "Time from startup to the end of each startup phase").record(micros);
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Phases.push_back(std::make_pair(phase, micros));
+	}
+
+	/*
+	* To be called with the duration of every process() call, in order.
+	* Returns true once, for the call that reaches the steady state.
+	*/
+	bool processed(const uint64_t processMicros) {
+		if (!m_nNumProcessed++) {
+			mark("first_result");
+		}
+		if (m_bSteady) {
+			return false;
+		}
+		m_Recent.push_back(processMicros);
+		if (m_Recent.size() > m_nWindow) {
+			m_Recent.erase(m_Recent.begin());
+		}
+		if (m_Recent.size() < m_nWindow) {
+			return false;
+		}
+		std::vector<uint64_t> sorted(m_Recent);
+		std::nth_element(sorted.begin(), sorted.begin() + sorted.size() / 2, sorted.end());
+		const double median = static_cast<double>(sorted[sorted.size() / 2]);
+		const double slowest = static_cast<double>(*std::max_element(m_Recent.begin(), m_Recent.end()));
+		if (slowest > median * (1.0 + m_fTolerance)) {
+			return false;
+		}
+		m_bSteady = true;
+		m_nSteadyFrame = m_nNumProcessed - m_nWindow;
+		mark("steady_state");
+		return true;
+	}
+
+	inline bool steady() const { return m_bSteady; }
+
+	// e.g. "init 812.4 ms, warm_up 1530.2 ms, ..., steady_state 4210.7 ms (from result #3)"
+	std::string summary() const {
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		std::ostringstream out;
+		out.setf(std::ios::fixed);
+		out.precision(1);
+		for (size_t i = 0; i < m_Phases.size(); ++i) {
+			out << (i ? ", " : "") << m_Phases[i].first << " " << m_Phases[i].second / 1000.0 << " ms";
+			if (m_Phases[i].first == "steady_state") {
+				out << " (from result #" << m_nSteadyFrame << ")";
+			}
+		}
+		if (!m_bSteady) {
+			out << (m_Phases.empty() ? "" : ", ") << "steady state not reached after " << m_nNumProcessed << " results";
+		}
+		return out.str();
+	}
+
+private:
+	AlprClock::time_point m_Start;
+	size_t m_nWindow;
+	double m_fTolerance;
+	mutable std::mutex m_Mutex;
+	std::vector<std::pair<std::string, uint64_t> > m_Phases;
+	std::vector<uint64_t> m_Recent;
+	size_t m_nNumProcessed;
+	size_t m_nSteadyFrame;
+	bool m_bSteady;
+};
+
+#endif /* _ALPR_METRICS_H_ */
@@ -0,0 +1,98 @@
+#if !defined(_ALPR_PIPELINE_H_)
+#define _ALPR_PIPELINE_H_
+
+#include <json.hpp> // nlohmann/json
+#include <algorithm> // std::replace
+#include <string>
+#include <vector>
+
+/*
+* Decision logic shared by the live loop, the replay mode and the tools: plate parsing,
+* normalization and the vote that confirms a plate once it was read 'numRepeat' times.
+*/
+
+struct AlprPlate {
+	std::string text;
+	std::vector<double> warpedBox; // x0, y0, x1, y1, x2, y2, x3, y3
+	double confidence = 0.0;
+};
+
+/*
+* Taiwanese plates are 6 or 7 characters long
+*/
+static inline bool alprIsValidPlate(const std::string& digits)
+{
+	return digits.length() == 6 || digits.length() == 7;
+}
+
+static inline void alprNormalizePlate(std::string& digits)
+{
+	std::replace(digits.begin(), digits.end(), 'I', '1'); // Taiwanese standard
+	std::replace(digits.begin(), digits.end(), 'O', '0'); // Taiwanese standard
+	std::replace(digits.begin(), digits.end(), 'W', 'M'); // ambiguous and M is far more than W
+}
+
+/*
+* Plates from a UltAlprSdkResult::json() string, in the order returned by the engine.
+* Plates with an invalid length are dropped, the others are normalized.
+*/
+static std::vector<AlprPlate> alprParsePlates(const std::string& json)
+{
+	std::vector<AlprPlate> plates;
+	if (json.empty()) {
+		return plates;
+	}
+	const nlohmann::json parsed = nlohmann::json::parse(json, nullptr, false);
+	if (parsed.is_discarded() || !parsed.contains("plates")) {
+		return plates;
+	}
+	for (const nlohmann::json& entry : parsed.at("plates")) {
+		AlprPlate plate;
+		plate.text = entry.at("text").get<std::string>();
+		if (!alprIsValidPlate(plate.text)) {
+			continue;
+		}
+		alprNormalizePlate(plate.text);
+		plate.warpedBox = entry.at("warpedBox").get<std::vector<double> >();
+		if (entry.contains("confidences") && !entry["confidences"].empty()) {
+			plate.confidence = entry["confidences"][0].get<double>();
+		}
+		plates.push_back(plate);
+	}
+	return plates;
+}
+
+/*
+* Sliding vote over the plates read in the last frames. A plate is confirmed when it has
+* been read exactly 'numRepeat' times, i.e. once per pass in front of the camera.
+* Every 'refresh' frames only the last 'residual' readings are kept.
+*/
+class AlprPlateVoter {
+public:
+	AlprPlateVoter(const int numRepeat = 5, const int refresh = 10000, const int residual = 200)
+		: m_nNumRepeat(numRepeat), m_nRefresh(refresh), m_nResidual(residual), m_nNumIter(0) {}
+
+	// To be called once per frame, before voting for its plates
+	void nextFrame() {
+		if (m_nNumIter++ > m_nRefresh) {
+			m_nNumIter = 0;
+			const size_t keep = std::min(m_AllPrevDigits.size(), static_cast<size_t>(m_nResidual));
+			m_AllPrevDigits = std::vector<std::string>(m_AllPrevDigits.end() - keep, m_AllPrevDigits.end());
+		}
+	}
+
+	// Returns true when this reading confirms the plate
+	bool vote(const std::string& digits) {
+		m_AllPrevDigits.push_back(digits);
+		return std::count(m_AllPrevDigits.begin(), m_AllPrevDigits.end(), digits) == m_nNumRepeat;
+	}
+
+	inline int numRepeat() const { return m_nNumRepeat; }
+
+private:
+	int m_nNumRepeat, m_nRefresh, m_nResidual;
+	int m_nNumIter;
+	std::vector<std::string> m_AllPrevDigits;
+};
+
+#endif /* _ALPR_PIPELINE_H_ */
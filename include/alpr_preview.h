@@ -0,0 +1,100 @@
+#if !defined(_ALPR_PREVIEW_H_)
+#define _ALPR_PREVIEW_H_
+
+#include <alpr_http.h>
+#include <opencv2/core.hpp>
+#include <opencv2/imgproc.hpp>
+#include <opencv2/imgcodecs.hpp>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/*
+* Low frame rate MJPEG preview over HTTP (multipart/x-mixed-replace), for the units without a
+* display. Frames are only downscaled and encoded when somebody is watching and at most
+* 'fps' times per second, so the preview costs nothing on the hot path the rest of the time.
+*/
+class AlprMjpegPreview {
+public:
+	AlprMjpegPreview(const double fps = 2.0, const int width = 640, const int quality = 70)
+		: m_dFps(fps > 0.0 ? fps : 2.0), m_nWidth(width), m_nQuality(quality), m_nClients(0), m_nSequence(0) {}
+
+	// Whether the caller should publish the current frame
+	bool due() const {
+		return m_nClients > 0 && std::chrono::steady_clock::now() >= m_NextPublish;
+	}
+
+	void publish(const cv::Mat& frame) {
+		m_NextPublish = std::chrono::steady_clock::now() + std::chrono::microseconds(static_cast<int64_t>(1e6 / m_dFps));
+		cv::Mat small;
+		if (frame.cols > m_nWidth) {
+			cv::resize(frame, small, cv::Size(m_nWidth, frame.rows * m_nWidth / frame.cols), 0, 0, cv::INTER_AREA);
+		}
+		else {
+			small = frame;
+		}
+		std::shared_ptr<std::vector<unsigned char> > jpeg = std::make_shared<std::vector<unsigned char> >();
+		if (!cv::imencode(".jpg", small, *jpeg, std::vector<int>{ cv::IMWRITE_JPEG_QUALITY, m_nQuality })) {
+			return;
+		}
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			m_Jpeg = jpeg;
+			++m_nSequence;
+		}
+		m_CondVar.notify_all();
+	}
+
+	// AlprHttpHandler for "/" and "/preview"
+	bool handle(const std::string& path, AlprHttpResponse& response) {
+		if (path != "/" && path != "/preview") {
+			return false;
+		}
+		response.contentType = "multipart/x-mixed-replace; boundary=frame";
+		response.stream = [this](int fd, const std::atomic<bool>& running) {
+			serve(fd, running);
+		};
+		return true;
+	}
+
+private:
+	void serve(const int fd, const std::atomic<bool>& running) {
+		++m_nClients;
+		uint64_t sent = 0;
+		while (running) {
+			std::shared_ptr<std::vector<unsigned char> > jpeg;
+			{
+				std::unique_lock<std::mutex> lock(m_Mutex);
+				m_CondVar.wait_for(lock, std::chrono::milliseconds(200), [this, sent] { return m_nSequence != sent; });
+				if (m_nSequence == sent || !m_Jpeg) {
+					continue;
+				}
+				sent = m_nSequence;
+				jpeg = m_Jpeg;
+			}
+			const std::string header = "--frame\r\nContent-Type: image/jpeg\r\nContent-Length: " + std::to_string(jpeg->size()) + "\r\n\r\n";
+			if (!AlprHttpServer::sendAll(fd, header.data(), header.size())
+				|| !AlprHttpServer::sendAll(fd, reinterpret_cast<const char*>(jpeg->data()), jpeg->size())
+				|| !AlprHttpServer::sendAll(fd, "\r\n", 2)) {
+				break; // client gone
+			}
+		}
+		--m_nClients;
+	}
+
+	double m_dFps;
+	int m_nWidth;
+	int m_nQuality;
+	std::atomic<int> m_nClients;
+	std::chrono::steady_clock::time_point m_NextPublish;
+	std::mutex m_Mutex;
+	std::condition_variable m_CondVar;
+	std::shared_ptr<std::vector<unsigned char> > m_Jpeg;
+	uint64_t m_nSequence;
+};
+
+#endif /* _ALPR_PREVIEW_H_ */
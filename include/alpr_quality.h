@@ -0,0 +1,208 @@
+#if !defined(_ALPR_QUALITY_H_)
+#define _ALPR_QUALITY_H_
+
+#include <ultimateALPR-SDK-API-PUBLIC.h>
+#include <opencv2/core.hpp>
+#include <json.hpp> // nlohmann/json
+#include <algorithm>
+#include <fstream>
+#include <string>
+#include <vector>
+
+/*
+* Quality tiers, from the best to the cheapest:
+*	"scale": downscale factor applied to the input, within ]0, 1]
+*	"roi": fraction of the frame width/height kept around the center of the configured detect_roi, within ]0, 1].
+*		The crop is a view (pointer + stride), no copy.
+*	"stride": only one frame out of 'stride' goes to the engine, the others are displayed without result
+* All of them are applied to the input before process(), the engine is never re-initialized: when the controller
+* is enabled, the detect_roi of the config is applied by the crop and the engine gets the whole input (see
+* alprQualityConfig). The pyramidal search needs a re-init (seconds, on the loop that is already late), it stays
+* as configured.
+*/
+struct AlprQualityTier {
+	std::string name;
+	double scale = 1.0;
+	double roi = 1.0;
+	int stride = 1;
+};
+
+static std::vector<AlprQualityTier> alprQualityDefaultTiers()
+{
+	std::vector<AlprQualityTier> tiers(4);
+	tiers[0].name = "full";
+	tiers[1].name = "roi"; tiers[1].roi = 0.75;
+	tiers[2].name = "roi+downscale"; tiers[2].roi = 0.75; tiers[2].scale = 0.75;
+	tiers[3].name = "roi+downscale+stride"; tiers[3].roi = 0.75; tiers[3].scale = 0.75; tiers[3].stride = 2;
+	return tiers;
+}
+
+/*
+* JSON array of tiers, e.g. [{"name": "full"}, {"name": "half", "scale": 0.5, "stride": 2}]
+*/
+static bool alprQualityLoadTiers(const std::string& path, std::vector<AlprQualityTier>& tiers)
+{
+	std::ifstream file(path.c_str());
+	if (!file) {
+		ULTALPR_SDK_PRINT_ERROR("Failed to open quality tiers: %s", path.c_str());
+		return false;
+	}
+	const nlohmann::json parsed = nlohmann::json::parse(file, nullptr, false);
+	if (parsed.is_discarded() || !parsed.is_array() || parsed.empty()) {
+		ULTALPR_SDK_PRINT_ERROR("%s: expected a non-empty JSON array of tiers", path.c_str());
+		return false;
+	}
+	tiers.clear();
+	for (const nlohmann::json& entry : parsed) {
+		AlprQualityTier tier;
+		tier.name = entry.value("name", "tier" + std::to_string(tiers.size()));
+		tier.scale = entry.value("scale", 1.0);
+		if (entry.contains("pyramidal")) {
+			ULTALPR_SDK_PRINT_WARN("%s: 'pyramidal' ignored in tier '%s', set pyramidal_search_enabled in the config", path.c_str(), tier.name.c_str());
+		}
+		tier.roi = entry.value("roi", 1.0);
+		tier.stride = entry.value("stride", 1);
+		if (tier.scale <= 0.0 || tier.scale > 1.0 || tier.roi <= 0.0 || tier.roi > 1.0 || tier.stride < 1) {
+			ULTALPR_SDK_PRINT_ERROR("%s: tier '%s' out of range (scale and roi within ]0, 1], stride >= 1)", path.c_str(), tier.name.c_str());
+			return false;
+		}
+		tiers.push_back(tier);
+	}
+	return true;
+}
+
+/*
+* Part of the frame given to the engine: the configured detect_roi ([left, right, top, bottom], all zeros for the
+* full frame) clipped to the frame, shrunk to 'roi' of the frame width/height around its center.
+* Equals the whole frame when there's nothing to crop.
+*/
+static cv::Rect alprQualityCrop(const cv::Size& frameSize, const std::vector<double>& detectRoi, const double roi)
+{
+	const cv::Rect full(0, 0, frameSize.width, frameSize.height);
+	cv::Rect area = full;
+	if (detectRoi.size() == 4 && (detectRoi[1] > detectRoi[0]) && (detectRoi[3] > detectRoi[2])) {
+		area = full & cv::Rect(cv::Point(static_cast<int>(detectRoi[0]), static_cast<int>(detectRoi[2])),
+			cv::Point(static_cast<int>(detectRoi[1]), static_cast<int>(detectRoi[3])));
+		if (area.empty()) {
+			area = full; // detect_roi outside of this resolution
+		}
+	}
+	if (roi >= 1.0) {
+		return area;
+	}
+	const double cx = area.x + area.width / 2.0, cy = area.y + area.height / 2.0;
+	const int width = std::min(area.width, std::max(1, static_cast<int>(frameSize.width * roi)));
+	const int height = std::min(area.height, std::max(1, static_cast<int>(frameSize.height * roi)));
+	const int x = std::min(std::max(area.x, static_cast<int>(cx - width / 2.0)), area.x + area.width - width);
+	const int y = std::min(std::max(area.y, static_cast<int>(cy - height / 2.0)), area.y + area.height - height);
+	return cv::Rect(x, y, width, height);
+}
+
+/*
+* Engine config when the controller is enabled: detect_roi is applied by the crop, the engine gets the whole
+* input whatever the tier -> no re-init when the tier changes
+*/
+static std::string alprQualityConfig(const std::string& jsonConfig)
+{
+	nlohmann::json config = nlohmann::json::parse(jsonConfig);
+	config["detect_roi"] = std::vector<double>(4, 0.0);
+	return config.dump();
+}
+
+/*
+* Feedback loop holding a target frame rate. Once per window (about one second of frames) it compares
+* the rate the loop could sustain (1 / mean busy time per frame, waiting for the camera excluded) and
+* the number of frames queued behind the current one with the target:
+*	- behind (capacity under 95% of the target, or frames queued): one tier cheaper
+*	- 3 windows in a row with 30% headroom and nothing queued: one tier better. An upgrade that has to be
+*		undone right away doubles the number of windows needed for the next one (up to 96), so that the
+*		controller doesn't bounce between two tiers; an upgrade that holds resets it.
+* The window following a change is ignored (caches, resize buffers). Every change is logged.
+*/
+class AlprQualityController {
+public:
+	AlprQualityController(const std::vector<AlprQualityTier>& tiers, const double targetFps)
+		: m_Tiers(tiers), m_dTargetFps(targetFps), m_nTier(0), m_nWindow(std::max(10, static_cast<int>(targetFps))),
+		m_nFrames(0), m_nBusyMicros(0), m_nQueued(0), m_nGoodWindows(0), m_nUpgradeWindows(3), m_nWindowsSinceChange(0),
+		m_bUpgraded(false), m_bSettling(false), m_nChanges(0) {}
+
+	inline bool enabled() const { return m_dTargetFps > 0 && m_Tiers.size() > 1; }
+	inline const AlprQualityTier& tier() const { return m_Tiers[m_nTier]; }
+	inline size_t tierIndex() const { return m_nTier; }
+	inline size_t changes() const { return m_nChanges; }
+
+	/*
+	* To be called once per frame. Returns true when the tier changed.
+	* @param busyMicros Time spent on the frame, capture wait excluded
+	* @param queued Frames waiting behind this one (e.g. in the driver's queue), 0 when unknown
+	*/
+	bool update(const uint64_t busyMicros, const size_t queued) {
+		if (!enabled()) {
+			return false;
+		}
+		m_nBusyMicros += busyMicros;
+		m_nQueued += queued;
+		if (++m_nFrames < m_nWindow) {
+			return false;
+		}
+		const double capacity = m_nBusyMicros ? (1e6 * m_nFrames) / m_nBusyMicros : m_dTargetFps;
+		const double meanQueued = static_cast<double>(m_nQueued) / m_nFrames;
+		m_nFrames = 0;
+		m_nBusyMicros = 0;
+		m_nQueued = 0;
+		if (m_bSettling) {
+			m_bSettling = false;
+			return false;
+		}
+		if (m_bUpgraded && ++m_nWindowsSinceChange >= 10) {
+			m_bUpgraded = false; // the last upgrade held
+			m_nUpgradeWindows = 3;
+		}
+		size_t next = m_nTier;
+		if ((capacity < m_dTargetFps * 0.95 || meanQueued >= 1.0) && m_nTier + 1 < m_Tiers.size()) {
+			next = m_nTier + 1;
+			m_nGoodWindows = 0;
+			if (m_bUpgraded) {
+				m_bUpgraded = false; // undone right away
+				m_nUpgradeWindows = std::min(m_nUpgradeWindows * 2, 96);
+			}
+		}
+		else if (capacity > m_dTargetFps * 1.3 && meanQueued < 0.5 && m_nTier > 0) {
+			if (++m_nGoodWindows >= m_nUpgradeWindows) {
+				next = m_nTier - 1;
+				m_nGoodWindows = 0;
+				m_bUpgraded = true;
+				m_nWindowsSinceChange = 0;
+			}
+		}
+		else {
+			m_nGoodWindows = 0;
+		}
+		if (next == m_nTier) {
+			return false;
+		}
+		ULTALPR_SDK_PRINT_INFO("Quality tier %s -> %s: %.1lf fps sustainable for a %.1lf fps target, %.1lf frame(s) queued",
+			m_Tiers[m_nTier].name.c_str(), m_Tiers[next].name.c_str(), capacity, m_dTargetFps, meanQueued);
+		m_nTier = next;
+		m_bSettling = true;
+		++m_nChanges;
+		return true;
+	}
+
+private:
+	std::vector<AlprQualityTier> m_Tiers;
+	double m_dTargetFps;
+	size_t m_nTier;
+	int m_nWindow;
+	int m_nFrames;
+	uint64_t m_nBusyMicros;
+	size_t m_nQueued;
+	int m_nGoodWindows;
+	int m_nUpgradeWindows;
+	int m_nWindowsSinceChange;
+	bool m_bUpgraded;
+	bool m_bSettling;
+	size_t m_nChanges;
+};
+
+#endif /* _ALPR_QUALITY_H_ */
@@ -0,0 +1,66 @@
+#if !defined(_ALPR_QUEUE_H_)
+#define _ALPR_QUEUE_H_
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+
+/*
+* Bounded blocking queue between one or more producers (e.g. decoders) and consumers (e.g. the engine).
+* push() blocks while the queue is full, which keeps the producers at most 'capacity' items ahead.
+* close() wakes everybody up: push() then fails and pop() fails once the queue is drained.
+*/
+template <typename T>
+class AlprBoundedQueue {
+public:
+	AlprBoundedQueue(const size_t capacity) : m_nCapacity(capacity ? capacity : 1), m_bClosed(false) {}
+
+	bool push(T item) {
+		std::unique_lock<std::mutex> lock(m_Mutex);
+		m_NotFull.wait(lock, [this] { return m_bClosed || m_Items.size() < m_nCapacity; });
+		if (m_bClosed) {
+			return false;
+		}
+		m_Items.push_back(std::move(item));
+		lock.unlock();
+		m_NotEmpty.notify_one();
+		return true;
+	}
+
+	bool pop(T& item) {
+		std::unique_lock<std::mutex> lock(m_Mutex);
+		m_NotEmpty.wait(lock, [this] { return m_bClosed || !m_Items.empty(); });
+		if (m_Items.empty()) {
+			return false; // closed and drained
+		}
+		item = std::move(m_Items.front());
+		m_Items.pop_front();
+		lock.unlock();
+		m_NotFull.notify_one();
+		return true;
+	}
+
+	void close() {
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			m_bClosed = true;
+		}
+		m_NotFull.notify_all();
+		m_NotEmpty.notify_all();
+	}
+
+	size_t size() const {
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		return m_Items.size();
+	}
+
+private:
+	size_t m_nCapacity;
+	bool m_bClosed;
+	std::deque<T> m_Items;
+	mutable std::mutex m_Mutex;
+	std::condition_variable m_NotFull;
+	std::condition_variable m_NotEmpty;
+};
+
+#endif /* _ALPR_QUEUE_H_ */
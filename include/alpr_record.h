@@ -0,0 +1,139 @@
+#if !defined(_ALPR_RECORD_H_)
+#define _ALPR_RECORD_H_
+
+#include <ultimateALPR-SDK-API-PUBLIC.h>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+/*
+* Recording of the engine results, one record per frame with at least one plate:
+*
+*	header: "ALPRREC1"
+*	record: u32 frame index, u32 JSON size, u64 capture timestamp in micros (since the first frame), JSON
+*
+* Frames without a plate are not written, the gaps in the frame indices keep the frame count
+* exact. The last record, with an empty JSON, marks the end of the stream. Integers are little-endian.
+*/
+#define ALPR_RECORD_MAGIC "ALPRREC1"
+
+struct AlprRecordEntry {
+	uint32_t frame = 0;
+	uint64_t timestampMicros = 0;
+	std::string json; // empty for the end marker
+};
+
+class AlprRecordWriter {
+public:
+	AlprRecordWriter() : m_pFile(nullptr), m_nFrames(0) {}
+	~AlprRecordWriter() {
+		close();
+	}
+
+	bool open(const std::string& path) {
+		m_pFile = fopen(path.c_str(), "wb");
+		if (!m_pFile) {
+			ULTALPR_SDK_PRINT_ERROR("Failed to create recording: %s", path.c_str());
+			return false;
+		}
+		setvbuf(m_pFile, nullptr, _IOFBF, 1 << 20);
+		fwrite(ALPR_RECORD_MAGIC, 1, 8, m_pFile);
+		return true;
+	}
+
+	inline bool isOpen() const { return m_pFile != nullptr; }
+
+	// To be called for every frame, frames without plates only bump the frame count
+	void write(const uint64_t timestampMicros, const std::string& json) {
+		if (m_pFile && !json.empty()) {
+			writeRecord(m_nFrames, timestampMicros, json);
+		}
+		m_nFrames++;
+		m_nLastTimestamp = timestampMicros;
+	}
+
+	void close() {
+		if (m_pFile) {
+			writeRecord(m_nFrames, m_nLastTimestamp, std::string());
+			fclose(m_pFile);
+			m_pFile = nullptr;
+		}
+	}
+
+private:
+	void writeRecord(const uint32_t frame, const uint64_t timestampMicros, const std::string& json) {
+		const uint32_t size = static_cast<uint32_t>(json.size());
+		uint8_t header[16];
+		for (int i = 0; i < 4; ++i) {
+			header[i] = static_cast<uint8_t>(frame >> (8 * i));
+			header[4 + i] = static_cast<uint8_t>(size >> (8 * i));
+		}
+		for (int i = 0; i < 8; ++i) {
+			header[8 + i] = static_cast<uint8_t>(timestampMicros >> (8 * i));
+		}
+		fwrite(header, 1, sizeof(header), m_pFile);
+		fwrite(json.data(), 1, json.size(), m_pFile);
+	}
+
+	FILE* m_pFile;
+	uint32_t m_nFrames;
+	uint64_t m_nLastTimestamp = 0;
+};
+
+class AlprRecordReader {
+public:
+	AlprRecordReader() : m_pFile(nullptr) {}
+	~AlprRecordReader() {
+		if (m_pFile) {
+			fclose(m_pFile);
+		}
+	}
+
+	bool open(const std::string& path) {
+		m_pFile = fopen(path.c_str(), "rb");
+		char magic[8];
+		if (!m_pFile || fread(magic, 1, 8, m_pFile) != 8 || memcmp(magic, ALPR_RECORD_MAGIC, 8) != 0) {
+			ULTALPR_SDK_PRINT_ERROR("Not a recording: %s", path.c_str());
+			return false;
+		}
+		setvbuf(m_pFile, nullptr, _IOFBF, 1 << 20);
+		return true;
+	}
+
+	// Whether the file starts with the recording magic
+	static bool isRecording(const std::string& path) {
+		FILE* file = fopen(path.c_str(), "rb");
+		char magic[8];
+		const bool yes = file && fread(magic, 1, 8, file) == 8 && memcmp(magic, ALPR_RECORD_MAGIC, 8) == 0;
+		if (file) {
+			fclose(file);
+		}
+		return yes;
+	}
+
+	// Returns false at the end of the file. The end marker is returned as an entry with an empty JSON.
+	bool next(AlprRecordEntry& entry) {
+		uint8_t header[16];
+		if (!m_pFile || fread(header, 1, sizeof(header), m_pFile) != sizeof(header)) {
+			return false;
+		}
+		uint32_t size = 0;
+		entry.frame = 0;
+		entry.timestampMicros = 0;
+		for (int i = 0; i < 4; ++i) {
+			entry.frame |= static_cast<uint32_t>(header[i]) << (8 * i);
+			size |= static_cast<uint32_t>(header[4 + i]) << (8 * i);
+		}
+		for (int i = 0; i < 8; ++i) {
+			entry.timestampMicros |= static_cast<uint64_t>(header[8 + i]) << (8 * i);
+		}
+		entry.json.resize(size);
+		return !size || fread(&entry.json[0], 1, size, m_pFile) == size;
+	}
+
+private:
+	FILE* m_pFile;
+};
+
+#endif /* _ALPR_RECORD_H_ */
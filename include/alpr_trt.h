@@ -0,0 +1,217 @@
+#if !defined(_ALPR_TRT_H_)
+#define _ALPR_TRT_H_
+
+#include <ultimateALPR-SDK-API-PUBLIC.h>
+#include <alpr_utils.h>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <errno.h>
+#include <sys/stat.h>
+
+/*
+* Fingerprints of the TensorRT plans (Jetson).
+* The plans in <assets>/models.tensorrt/optimized are built for one device, one TensorRT version and one set of
+* models by UltAlprSdkEngine::optimizeTRT (see trt_prepare.cpp). When they are missing or don't match, the SDK
+* rebuilds them or falls back silently at init(), which takes minutes on a Jetson.
+* After a build, alprTrtRecord() writes the manifest (optimized/plans.manifest), one tab-separated line per input:
+*	platform	<device model and L4T release>
+*	runtime	<path>	<size>	<mtime>	<fnv1a-64>	(the TensorRT plugin)
+*	model	<name>	<size>	<mtime>	<fnv1a-64>	(the sources in models.tensorrt)
+*	plan	<name>	<size>	<mtime>	<fnv1a-64>	(the outputs in models.tensorrt/optimized)
+* alprTrtCheck() compares the current files with it. A file whose size and mtime are unchanged is not hashed,
+* so the check costs a few stat() calls at startup.
+*/
+
+static const char* kAlprTrtManifest = "plans.manifest";
+
+struct AlprTrtFingerprint {
+	uint64_t size = 0;
+	int64_t mtime = 0;
+	uint64_t hash = 0;
+};
+
+// FNV-1a over the whole file, mmap'ed
+static bool alprTrtHash(const std::string& path, uint64_t& hash)
+{
+	AlprMappedFile file;
+	if (!file.open(path)) {
+		return false;
+	}
+	const uint8_t* data = static_cast<const uint8_t*>(file.data());
+	hash = 0xcbf29ce484222325ULL;
+	for (size_t i = 0; i < file.size(); ++i) {
+		hash = (hash ^ data[i]) * 0x100000001b3ULL;
+	}
+	return true;
+}
+
+static bool alprTrtStat(const std::string& path, AlprTrtFingerprint& fingerprint)
+{
+	struct stat st;
+	if (stat(path.c_str(), &st) != 0 || !S_ISREG(st.st_mode)) {
+		return false;
+	}
+	fingerprint.size = static_cast<uint64_t>(st.st_size);
+	fingerprint.mtime = static_cast<int64_t>(st.st_mtime);
+	return true;
+}
+
+/*
+* Device the plans are built for: the Jetson model and the L4T (JetPack) release, which comes with the TensorRT version.
+* Empty on other hosts.
+*/
+static std::string alprTrtPlatform()
+{
+	std::string platform;
+	std::ifstream model("/proc/device-tree/model");
+	std::getline(model, platform, '\0');
+	std::ifstream release("/etc/nv_tegra_release");
+	std::string line;
+	if (std::getline(release, line)) {
+		platform += (platform.empty() ? "" : " / ") + line.substr(0, line.find(','));
+	}
+	for (char& c : platform) {
+		if (c == '\t' || c == '\n') {
+			c = ' ';
+		}
+	}
+	return platform;
+}
+
+/*
+* Sources and plans under <assets>/models.tensorrt, by kind ("model" or "plan") and name relative to the folder
+*/
+static void alprTrtListFiles(const std::string& assetsFolder, std::map<std::string, std::string>& files)
+{
+	const std::string folder = assetsFolder + "/models.tensorrt/";
+	std::vector<std::string> paths;
+	struct stat st;
+	if (stat(folder.c_str(), &st) != 0 || !alprListFiles(folder, paths)) {
+		return;
+	}
+	for (const std::string& path : paths) {
+		const std::string name = path.substr(folder.size());
+		const std::string base = name.substr(name.find_last_of('/') + 1);
+		if (base.empty() || base[0] == '.' || base == "README.md" || base == kAlprTrtManifest) {
+			continue;
+		}
+		files[name] = (name.compare(0, 10, "optimized/") == 0) ? "plan" : "model";
+	}
+}
+
+/*
+* To be called after a successful UltAlprSdkEngine::optimizeTRT. 'pluginPath' is the TensorRT plugin the SDK loads
+* (libultimatePluginTensorRT.so), may be empty.
+*/
+static bool alprTrtRecord(const std::string& assetsFolder, const std::string& pluginPath)
+{
+	std::map<std::string, std::string> files;
+	alprTrtListFiles(assetsFolder, files);
+	size_t numPlans = 0;
+	std::ostringstream manifest;
+	manifest << "platform\t" << alprTrtPlatform() << "\n";
+	std::vector<std::pair<std::string, std::string> > entries;
+	if (!pluginPath.empty()) {
+		entries.push_back(std::make_pair(std::string("runtime"), pluginPath));
+	}
+	for (const std::pair<const std::string, std::string>& file : files) {
+		entries.push_back(std::make_pair(file.second, file.first));
+		numPlans += (file.second == "plan");
+	}
+	if (!numPlans) {
+		ULTALPR_SDK_PRINT_ERROR("No plan in %s/models.tensorrt/optimized", assetsFolder.c_str());
+		return false;
+	}
+	for (const std::pair<std::string, std::string>& entry : entries) {
+		const std::string path = (entry.first == "runtime") ? entry.second : assetsFolder + "/models.tensorrt/" + entry.second;
+		AlprTrtFingerprint fingerprint;
+		if (!alprTrtStat(path, fingerprint) || !alprTrtHash(path, fingerprint.hash)) {
+			ULTALPR_SDK_PRINT_ERROR("Failed to fingerprint %s", path.c_str());
+			return false;
+		}
+		char line[64];
+		snprintf(line, sizeof(line), "\t%" PRIu64 "\t%" PRId64 "\t%016" PRIx64 "\n", fingerprint.size, fingerprint.mtime, fingerprint.hash);
+		manifest << entry.first << "\t" << entry.second << line;
+	}
+	// Written next to the manifest then renamed over it: an interrupted run leaves the previous one whole
+	const std::string path = assetsFolder + "/models.tensorrt/optimized/" + kAlprTrtManifest;
+	const std::string tmpPath = path + ".tmp";
+	std::ofstream output(tmpPath.c_str(), std::ios::binary | std::ios::trunc);
+	output << manifest.str();
+	output.close();
+	if (!output || std::rename(tmpPath.c_str(), path.c_str()) != 0) {
+		ULTALPR_SDK_PRINT_ERROR("Failed to write %s: %s", path.c_str(), strerror(errno));
+		std::remove(tmpPath.c_str());
+		return false;
+	}
+	ULTALPR_SDK_PRINT_INFO("Recorded %zu plans in %s", numPlans, path.c_str());
+	return true;
+}
+
+/*
+* Returns false when the plans must be rebuilt, with the reasons in 'problems' (missing manifest, other device,
+* changed plugin or model, missing or modified plan...).
+*/
+static bool alprTrtCheck(const std::string& assetsFolder, const std::string& pluginPath, std::vector<std::string>& problems)
+{
+	const std::string manifestPath = assetsFolder + "/models.tensorrt/optimized/" + kAlprTrtManifest;
+	std::ifstream manifest(manifestPath.c_str());
+	if (!manifest) {
+		problems.push_back("no " + manifestPath + ", plans never built by trt_prepare");
+		return false;
+	}
+	std::map<std::string, std::string> files;
+	alprTrtListFiles(assetsFolder, files);
+	std::string line;
+	while (std::getline(manifest, line)) {
+		std::istringstream fields(line);
+		std::string kind, name;
+		std::getline(fields, kind, '\t');
+		std::getline(fields, name, '\t');
+		if (kind == "platform") {
+			const std::string platform = alprTrtPlatform();
+			if (name != platform) {
+				problems.push_back("built for '" + name + "', running on '" + platform + "'");
+			}
+			continue;
+		}
+		AlprTrtFingerprint recorded, current;
+		std::string hash;
+		if (!(fields >> recorded.size >> recorded.mtime >> hash)) {
+			continue;
+		}
+		recorded.hash = std::strtoull(hash.c_str(), nullptr, 16);
+		std::string path = assetsFolder + "/models.tensorrt/" + name;
+		if (kind == "runtime") {
+			if (pluginPath.empty()) {
+				continue;
+			}
+			path = pluginPath;
+		}
+		else {
+			files.erase(name);
+		}
+		if (!alprTrtStat(path, current)) {
+			problems.push_back(kind + " " + name + " is missing");
+			continue;
+		}
+		if (current.size == recorded.size && current.mtime == recorded.mtime) {
+			continue; // unchanged, not worth hashing
+		}
+		if (current.size != recorded.size || !alprTrtHash(path, current.hash) || current.hash != recorded.hash) {
+			problems.push_back(kind + " " + name + " changed since the plans were built");
+		}
+	}
+	for (const std::pair<const std::string, std::string>& file : files) {
+		problems.push_back(file.second + " " + file.first + " is new since the plans were built");
+	}
+	return problems.empty();
+}
+
+#endif /* _ALPR_TRT_H_ */
@@ -6,77 +6,501 @@
 #include <stdlib.h>
 #include <map>
 #include <sys/stat.h>
+#include <dirent.h>
 #include <codecvt>
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <ctype.h>
+#include <string.h>
+#include <memory>
+#include <stdio.h>
+#include <stdint.h>
+#include <limits.h>
+#if !ULTALPR_SDK_OS_ANDROID
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/mman.h>
+#endif /* !ULTALPR_SDK_OS_ANDROID */
 
 // Not part of the SDK, used to decode images -> https://github.com/nothings/stb
 #define STB_IMAGE_IMPLEMENTATION
 #define STB_IMAGE_STATIC
 #include "stb_image.h"
 
+// Optional, JPEG decoding with libjpeg(-turbo), see CMakeLists.txt
+#if ALPR_HAVE_LIBJPEG
+#include <setjmp.h>
+#include <jpeglib.h>
+#	if JPEG_LIB_VERSION < 80 && !defined(MEM_SRCDST_SUPPORTED) // jpeg_mem_src() is needed
+#		undef ALPR_HAVE_LIBJPEG
+#		define ALPR_HAVE_LIBJPEG 0
+#	endif
+#endif /* ALPR_HAVE_LIBJPEG */
+
 #if ULTALPR_SDK_OS_ANDROID
 #include "alpr_utils.h"
 #endif /* ULTALPR_SDK_OS_ANDROID */
 
 using namespace ultimateAlprSdk;
 
+/*
+* Pixel buffers recycled between decodes: a stream of images of similar sizes stops paying
+* malloc/free, and the page faults of fresh memory, for every file. Thread-safe.
+* Buffers are 64-byte aligned and released with free().
+*/
+class AlprBufferPool {
+public:
+	AlprBufferPool(const size_t maxBuffers = 16) : m_nMaxBuffers(maxBuffers) {}
+	~AlprBufferPool() {
+		for (const Buffer& buffer : m_Buffers) {
+			free(buffer.data);
+		}
+	}
+
+	// Smallest cached buffer holding at least 'size' bytes, a new one otherwise
+	void* acquire(const size_t size, size_t& capacity) {
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			size_t best = m_Buffers.size();
+			for (size_t i = 0; i < m_Buffers.size(); ++i) {
+				if (m_Buffers[i].capacity >= size && (best == m_Buffers.size() || m_Buffers[i].capacity < m_Buffers[best].capacity)) {
+					best = i;
+				}
+			}
+			if (best < m_Buffers.size()) {
+				void* data = m_Buffers[best].data;
+				capacity = m_Buffers[best].capacity;
+				m_Buffers[best] = m_Buffers.back();
+				m_Buffers.pop_back();
+				return data;
+			}
+		}
+		void* data = nullptr;
+		if (posix_memalign(&data, 64, size) != 0) {
+			return nullptr;
+		}
+		capacity = size;
+		return data;
+	}
+
+	// When the pool is full the smallest buffer is dropped
+	void recycle(void* data, const size_t capacity) {
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Buffers.push_back({ data, capacity });
+		if (m_Buffers.size() > m_nMaxBuffers) {
+			size_t smallest = 0;
+			for (size_t i = 1; i < m_Buffers.size(); ++i) {
+				if (m_Buffers[i].capacity < m_Buffers[smallest].capacity) {
+					smallest = i;
+				}
+			}
+			free(m_Buffers[smallest].data);
+			m_Buffers[smallest] = m_Buffers.back();
+			m_Buffers.pop_back();
+		}
+	}
+
+private:
+	AlprBufferPool(const AlprBufferPool&) = delete;
+	AlprBufferPool& operator=(const AlprBufferPool&) = delete;
+
+	struct Buffer {
+		void* data;
+		size_t capacity;
+	};
+	size_t m_nMaxBuffers;
+	std::mutex m_Mutex;
+	std::vector<Buffer> m_Buffers;
+};
+
+/*
+* Read-only view of a whole file: mapped with mmap(), or read into memory for the Android assets.
+* 'sequential' is a hint that the file is read once from start to end (madvise(MADV_SEQUENTIAL)):
+* aggressive read-ahead, pages dropped soon after use, what decoding a folder of images needs.
+* 'copy' reads the file with read() instead of mapping it, for files that another process may still
+* truncate (the pages of a mapping past the new end raise SIGBUS when touched).
+*/
+class AlprMappedFile {
+public:
+	AlprMappedFile() : m_pData(nullptr), m_nSize(0), m_bMapped(false) {}
+	~AlprMappedFile() {
+		close();
+	}
+
+	bool open(const std::string& path, const bool sequential = true, const bool copy = false) {
+		close();
+#	if ULTALPR_SDK_OS_ANDROID
+		FILE* file = sdk_android_asset_fopen(path.c_str(), "rb");
+		if (!file) {
+			ULTALPR_SDK_PRINT_ERROR("Failed to open file at: %s", path.c_str());
+			return false;
+		}
+		fseek(file, 0, SEEK_END);
+		const long size = ftell(file);
+		fseek(file, 0, SEEK_SET);
+		if (size > 0 && (m_pData = malloc(static_cast<size_t>(size)))) {
+			m_nSize = fread(m_pData, 1, static_cast<size_t>(size), file);
+		}
+		fclose(file);
+		(void)sequential;
+		(void)copy;
+#	else
+		const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+		if (fd < 0) {
+			ULTALPR_SDK_PRINT_ERROR("Failed to open file at: %s", path.c_str());
+			return false;
+		}
+		struct stat st;
+		if (fstat(fd, &st) == 0 && st.st_size > 0) {
+			if (copy) {
+				if ((m_pData = malloc(static_cast<size_t>(st.st_size)))) {
+					ssize_t count;
+					while (m_nSize < static_cast<size_t>(st.st_size)
+						&& ((count = ::read(fd, static_cast<uint8_t*>(m_pData) + m_nSize, static_cast<size_t>(st.st_size) - m_nSize)) > 0 || (count < 0 && errno == EINTR))) {
+						m_nSize += (count > 0) ? static_cast<size_t>(count) : 0; // short when truncated meanwhile
+					}
+				}
+			}
+			else {
+				void* data = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+				if (data != MAP_FAILED) {
+					m_pData = data;
+					m_nSize = static_cast<size_t>(st.st_size);
+					m_bMapped = true;
+					if (sequential) {
+						madvise(m_pData, m_nSize, MADV_SEQUENTIAL);
+					}
+				}
+			}
+		}
+		::close(fd); // the mapping stays valid
+#	endif
+		if (!m_nSize) {
+			ULTALPR_SDK_PRINT_ERROR("Failed to read file at: %s", path.c_str());
+			close();
+			return false;
+		}
+		return true;
+	}
+
+	void close() {
+		if (m_pData) {
+			if (m_bMapped) {
+				munmap(m_pData, m_nSize);
+			}
+			else {
+				free(m_pData);
+			}
+		}
+		m_pData = nullptr;
+		m_nSize = 0;
+		m_bMapped = false;
+	}
+
+	inline const uint8_t* data() const { return reinterpret_cast<const uint8_t*>(m_pData); }
+	inline size_t size() const { return m_nSize; }
+
+private:
+	AlprMappedFile(const AlprMappedFile&) = delete;
+	AlprMappedFile& operator=(const AlprMappedFile&) = delete;
+
+	void* m_pData;
+	size_t m_nSize;
+	bool m_bMapped;
+};
+
 /*
 * File description
+* The buffer is kept by the next decode into the same AlprFile when large enough. It comes from
+* malloc (the default), from a pool (returned to it by release()) or from the caller (see wrap()).
+* Images stored without compression (PPM/PGM, Y4M) point into 'mapping' instead, there is no buffer.
 */
 struct AlprFile {
 	void* uncompressedData = nullptr;
 	size_t width = 0;
 	size_t height = 0;
 	ULTALPR_SDK_IMAGE_TYPE type;
+	size_t capacity = 0; // size of the buffer at 'uncompressedData', in bytes
+	AlprBufferPool* pool = nullptr;
+	bool owned = true;
+	std::unique_ptr<AlprMappedFile> mapping;
+
+	AlprFile() = default;
+	AlprFile(AlprFile&& other) {
+		*this = std::move(other);
+	}
+	AlprFile& operator=(AlprFile&& other) {
+		if (this != &other) {
+			release();
+			uncompressedData = other.uncompressedData;
+			width = other.width;
+			height = other.height;
+			type = other.type;
+			capacity = other.capacity;
+			pool = other.pool;
+			owned = other.owned;
+			mapping = std::move(other.mapping);
+			other.uncompressedData = nullptr;
+			other.release();
+		}
+		return *this;
+	}
 
 	virtual ~AlprFile() {
 		release();
 	}
 
 	void release() {
-		if (uncompressedData) {
-			free(uncompressedData);
-			uncompressedData = nullptr;
+		if (uncompressedData && owned && !mapping) {
+			if (pool) {
+				pool->recycle(uncompressedData, capacity);
+			}
+			else {
+				free(uncompressedData);
+			}
+		}
+		uncompressedData = nullptr;
+		width = height = capacity = 0;
+		pool = nullptr;
+		owned = true;
+		mapping.reset();
+	}
+
+	// Decode into 'buffer', still owned by the caller, as long as the images fit in 'size' bytes
+	void wrap(void* buffer, const size_t size) {
+		release();
+		uncompressedData = buffer;
+		capacity = size;
+		owned = false;
+	}
+
+	// Makes room for 'size' bytes, reusing the current buffer when large enough
+	bool reserve(const size_t size, AlprBufferPool* fromPool = nullptr) {
+		if (uncompressedData && !mapping && capacity >= size) {
+			return true;
+		}
+		release();
+		if (fromPool) {
+			uncompressedData = fromPool->acquire(size, capacity);
+			pool = uncompressedData ? fromPool : nullptr;
+		}
+		else if ((uncompressedData = malloc(size))) {
+			capacity = size;
 		}
+		return uncompressedData != nullptr;
 	}
 
 	inline bool isValid() const {
 		return (uncompressedData != nullptr && width && height);
 	}
+
+private:
+	AlprFile(const AlprFile&) = delete;
+	AlprFile& operator=(const AlprFile&) = delete;
+};
+
+#if ALPR_HAVE_LIBJPEG
+struct AlprJpegError {
+	struct jpeg_error_mgr mgr;
+	jmp_buf jump;
 };
 
+static void alprJpegErrorExit(j_common_ptr cinfo)
+{
+	longjmp(reinterpret_cast<AlprJpegError*>(cinfo->err)->jump, 1);
+}
+
 /*
-* Decodes a JPEG/PNG/BMP file
-* @param path 
-* @param type 
-* @param width
-* @param height
-* @returns 
+* JPEG decoding straight into the AlprFile buffer. libjpeg-turbo does the colour conversion with SIMD
+* and, for Y, skips it entirely (the luma plane is output as is). Returns false, without printing
+* anything, on any error or unsupported file (e.g. CMYK), the caller then tries stb_image.
 */
-static bool alprDecodeFile(const std::string& path, AlprFile& alprFile)
+static bool alprDecodeJpeg(const uint8_t* data, const size_t size, AlprFile& alprFile, const int channels, const ULTALPR_SDK_IMAGE_TYPE wantedType, AlprBufferPool* pool)
+{
+	struct jpeg_decompress_struct cinfo;
+	AlprJpegError error;
+	cinfo.err = jpeg_std_error(&error.mgr);
+	error.mgr.error_exit = alprJpegErrorExit;
+	if (setjmp(error.jump)) {
+		jpeg_destroy_decompress(&cinfo);
+		alprFile.width = alprFile.height = 0;
+		return false;
+	}
+	jpeg_create_decompress(&cinfo);
+	jpeg_mem_src(&cinfo, const_cast<unsigned char*>(data), static_cast<unsigned long>(size));
+	jpeg_read_header(&cinfo, TRUE);
+	if (cinfo.num_components != 1 && cinfo.num_components != 3) {
+		jpeg_destroy_decompress(&cinfo);
+		return false;
+	}
+	ULTALPR_SDK_IMAGE_TYPE type = ULTALPR_SDK_IMAGE_TYPE_RGB24;
+	cinfo.out_color_space = JCS_RGB;
+	if (channels == 1 || (!channels && cinfo.num_components == 1)) {
+		type = ULTALPR_SDK_IMAGE_TYPE_Y;
+		cinfo.out_color_space = JCS_GRAYSCALE;
+	}
+#	if defined(JCS_EXTENSIONS)
+	else if (wantedType == ULTALPR_SDK_IMAGE_TYPE_BGR24) {
+		type = ULTALPR_SDK_IMAGE_TYPE_BGR24;
+		cinfo.out_color_space = JCS_EXT_BGR;
+	}
+#	endif
+	jpeg_start_decompress(&cinfo);
+	const size_t stride = static_cast<size_t>(cinfo.output_width) * cinfo.output_components;
+	if (!alprFile.reserve(stride * cinfo.output_height, pool)) {
+		jpeg_destroy_decompress(&cinfo);
+		return false;
+	}
+	uint8_t* pixels = reinterpret_cast<uint8_t*>(alprFile.uncompressedData);
+	JSAMPROW rows[16];
+	while (cinfo.output_scanline < cinfo.output_height) {
+		const JDIMENSION count = std::min<JDIMENSION>(16, cinfo.output_height - cinfo.output_scanline);
+		for (JDIMENSION i = 0; i < count; ++i) {
+			rows[i] = pixels + (cinfo.output_scanline + i) * stride;
+		}
+		jpeg_read_scanlines(&cinfo, rows, count);
+	}
+	jpeg_finish_decompress(&cinfo);
+	jpeg_destroy_decompress(&cinfo);
+	alprFile.type = type;
+	alprFile.width = cinfo.output_width;
+	alprFile.height = cinfo.output_height;
+	return true;
+}
+#endif /* ALPR_HAVE_LIBJPEG */
+
+/*
+* Images stored without compression are used in place, from the mapped file:
+*	PPM (P6) as RGB24 and PGM (P5) as Y, 8 bits per sample
+*	Y4M (YUV4MPEG2, 8 bits), the luma plane of the first frame as Y, whatever the chroma subsampling
+* Returns false when the file is none of these, 'mapping' is then left untouched.
+*/
+static bool alprMapUncompressed(std::unique_ptr<AlprMappedFile>& mapping, AlprFile& alprFile)
+{
+	const uint8_t* data = mapping->data();
+	const size_t size = mapping->size();
+	size_t width = 0, height = 0, channels = 1, offset = 0;
+	if (size > 2 && data[0] == 'P' && (data[1] == '5' || data[1] == '6')) {
+		// "P6 <width> <height> <maxval>" then one whitespace, '#' starts a comment
+		size_t pos = 2, values[3];
+		for (size_t i = 0; i < 3; ++i) {
+			while (pos < size && (isspace(data[pos]) || data[pos] == '#')) {
+				if (data[pos] == '#') {
+					while (pos < size && data[pos] != '\n') {
+						++pos;
+					}
+				}
+				else {
+					++pos;
+				}
+			}
+			if (pos >= size || !isdigit(data[pos])) {
+				return false;
+			}
+			values[i] = 0;
+			while (pos < size && isdigit(data[pos]) && values[i] < 1000000) {
+				values[i] = (values[i] * 10) + (data[pos++] - '0');
+			}
+		}
+		if (pos >= size || !isspace(data[pos]) || !values[2] || values[2] > 255) {
+			return false;
+		}
+		width = values[0];
+		height = values[1];
+		channels = (data[1] == '6') ? 3 : 1;
+		offset = pos + 1;
+	}
+	else if (size > 10 && memcmp(data, "YUV4MPEG2 ", 10) == 0) {
+		// "YUV4MPEG2 W<width> H<height> ...\n" then "FRAME[ params]\n" and the planes, Y first
+		const uint8_t* header = reinterpret_cast<const uint8_t*>(memchr(data, '\n', size));
+		if (!header) {
+			return false;
+		}
+		const std::string params(reinterpret_cast<const char*>(data) + 9, reinterpret_cast<const char*>(header));
+		for (size_t pos = params.find(' '); pos != std::string::npos; pos = params.find(' ', pos + 1)) {
+			if (params[pos + 1] == 'W') {
+				width = static_cast<size_t>(std::atol(params.c_str() + pos + 2));
+			}
+			else if (params[pos + 1] == 'H') {
+				height = static_cast<size_t>(std::atol(params.c_str() + pos + 2));
+			}
+			else if (params[pos + 1] == 'C') {
+				const std::string colourspace = params.substr(pos + 1, params.find(' ', pos + 1) - (pos + 1));
+				if (colourspace.find("p1") != std::string::npos || colourspace.find("mono1") != std::string::npos) {
+					return false; // more than 8 bits, e.g. C420p10
+				}
+			}
+		}
+		offset = (header - data) + 1;
+		const uint8_t* frame = reinterpret_cast<const uint8_t*>(memchr(data + offset, '\n', size - offset));
+		if (size - offset < 5 || memcmp(data + offset, "FRAME", 5) != 0 || !frame) {
+			return false;
+		}
+		offset = (frame - data) + 1;
+	}
+	else {
+		return false;
+	}
+	if (!width || !height || offset + (width * height * channels) > size) {
+		return false;
+	}
+	alprFile.release();
+	alprFile.type = (channels == 3) ? ULTALPR_SDK_IMAGE_TYPE_RGB24 : ULTALPR_SDK_IMAGE_TYPE_Y;
+	alprFile.uncompressedData = const_cast<uint8_t*>(data + offset); // read-only
+	alprFile.width = width;
+	alprFile.height = height;
+	alprFile.capacity = width * height * channels;
+	alprFile.mapping = std::move(mapping);
+	return true;
+}
+
+/*
+* Shared by the alprDecodeFile overloads: 'channels' is 1 or 3, 0 for the channels of the file
+*/
+static bool alprDecodeFileAs(const std::string& path, AlprFile& alprFile, const int channels, const ULTALPR_SDK_IMAGE_TYPE wantedType, AlprBufferPool* pool, const bool copy = false)
 {
 	ULTALPR_SDK_ASSERT(!path.empty());
 
-	// Open file
-	FILE* file =
-#	if ULTALPR_SDK_OS_ANDROID
-		sdk_android_asset_fopen(path.c_str(), "rb");
-#	else
-		fopen(path.c_str(), "rb");
-#	endif
-	if (!file) {
-		ULTALPR_SDK_PRINT_ERROR("Failed to open file at: %s", path.c_str());
+	// Map the file, read-ahead and pages dropped behind the decoder
+	std::unique_ptr<AlprMappedFile> mapping(new AlprMappedFile());
+	if (!mapping->open(path, true, copy)) {
+		alprFile.width = alprFile.height = 0;
+		return false;
+	}
+	if (alprMapUncompressed(mapping, alprFile)) {
+		return true;
+	}
+	const uint8_t* data = mapping->data();
+	const size_t size = mapping->size();
+
+#	if ALPR_HAVE_LIBJPEG
+	if (size > 3 && data[0] == 0xFF && data[1] == 0xD8 && data[2] == 0xFF) {
+		if (alprDecodeJpeg(data, size, alprFile, channels, wantedType, pool)) {
+			return true;
+		}
+	}
+#	endif /* ALPR_HAVE_LIBJPEG */
+	if (size > static_cast<size_t>(INT_MAX)) {
+		ULTALPR_SDK_PRINT_ERROR("File too large: %s", path.c_str());
+		alprFile.width = alprFile.height = 0;
 		return false;
 	}
 
 	// Decode the file
-	int width, height, channels;
-	stbi_uc* uncompressedData = stbi_load_from_file(file, &width, &height, &channels, 0);
-	fclose(file);
-	if (!uncompressedData || width <= 0 || height <= 0 || (channels != 1 && channels != 3 && channels != 4)) {
-		ULTALPR_SDK_PRINT_ERROR("Invalid file(%s, %d, %d, %d)", path.c_str(), width, height, channels);
+	int width = 0, height = 0, fileChannels = 0;
+	stbi_uc* uncompressedData = stbi_load_from_memory(data, static_cast<int>(size), &width, &height, &fileChannels, channels);
+	const int outChannels = channels ? channels : fileChannels;
+	if (!uncompressedData || width <= 0 || height <= 0 || (outChannels != 1 && outChannels != 3 && outChannels != 4)) {
+		ULTALPR_SDK_PRINT_ERROR("Invalid file(%s, %d, %d, %d)", path.c_str(), width, height, outChannels);
 		if (uncompressedData) {
 			free(uncompressedData);
 		}
+		alprFile.width = alprFile.height = 0;
 		return false;
 	}
 
@@ -84,11 +508,119 @@ static bool alprDecodeFile(const std::string& path, AlprFile& alprFile)
 	// If you're using data from your camera then, it should be YUV-family and you don't need
 	// to convert to RGB-family.
 	// List of supported types: https://www.doubango.org/SDKs/anpr/docs/cpp-api.html#_CPPv4N15ultimateAlprSdk22ULTALPR_SDK_IMAGE_TYPEE
-	alprFile.type = (channels == 3) ? ULTALPR_SDK_IMAGE_TYPE_RGB24 : (channels == 1 ? ULTALPR_SDK_IMAGE_TYPE_Y : ULTALPR_SDK_IMAGE_TYPE_RGBA32);
+	alprFile.release();
+	alprFile.type = (outChannels == 3) ? ULTALPR_SDK_IMAGE_TYPE_RGB24 : (outChannels == 1 ? ULTALPR_SDK_IMAGE_TYPE_Y : ULTALPR_SDK_IMAGE_TYPE_RGBA32);
 	alprFile.uncompressedData = uncompressedData;
 	alprFile.width = static_cast<size_t>(width);
 	alprFile.height = static_cast<size_t>(height);
+	alprFile.capacity = alprFile.width * alprFile.height * outChannels;
+
+	return true;
+}
 
+/*
+* Decodes a JPEG/PNG/BMP file with the channels of the file: Y, RGB24 or RGBA32.
+* PPM/PGM and Y4M files are not decoded but mapped, see alprMapUncompressed.
+* @param path 
+* @param type 
+* @param width
+* @param height
+* @returns 
+*/
+static bool alprDecodeFile(const std::string& path, AlprFile& alprFile)
+{
+	return alprDecodeFileAs(path, alprFile, 0, ULTALPR_SDK_IMAGE_TYPE_RGB24, nullptr);
+}
+
+/*
+* Decodes a JPEG/PNG/BMP file into 'wantedType' (RGB24, BGR24 or Y), layouts the engine takes as is:
+* no conversion pass between decoding and process(). BGR24 needs libjpeg-turbo and a JPEG file,
+* it's RGB24 otherwise, check alprFile.type.
+* With libjpeg(-turbo) (ALPR_HAVE_LIBJPEG) JPEG files are decoded into the buffer already held by
+* 'alprFile' when large enough, or one from 'pool'. The other files, and every file without libjpeg,
+* are decoded by stb_image which allocates its own buffer.
+* PPM/PGM and Y4M files are mapped and passed as is (RGB24 or Y, whatever 'wantedType').
+* 'copy' reads the file instead of mapping it, for files that may still be written (see AlprMappedFile).
+* Thread-safe, see alprDecodeFiles to decode several files at once.
+*/
+static bool alprDecodeFile(const std::string& path, AlprFile& alprFile, const ULTALPR_SDK_IMAGE_TYPE wantedType, AlprBufferPool* pool = nullptr, const bool copy = false)
+{
+	ULTALPR_SDK_ASSERT(wantedType == ULTALPR_SDK_IMAGE_TYPE_RGB24 || wantedType == ULTALPR_SDK_IMAGE_TYPE_BGR24 || wantedType == ULTALPR_SDK_IMAGE_TYPE_Y);
+	return alprDecodeFileAs(path, alprFile, (wantedType == ULTALPR_SDK_IMAGE_TYPE_Y) ? 1 : 3, wantedType, pool, copy);
+}
+
+/*
+* Decodes 'paths' into 'files' (same indices) with 'numThreads' workers, 0 for one per core.
+* 'files' keeps its buffers from a previous call, so the same vector can be reused batch after batch.
+* Returns the number of files decoded, the others are left invalid.
+*/
+static size_t alprDecodeFiles(const std::vector<std::string>& paths, std::vector<AlprFile>& files, const ULTALPR_SDK_IMAGE_TYPE wantedType, size_t numThreads = 0, AlprBufferPool* pool = nullptr)
+{
+	files.resize(paths.size());
+	if (!numThreads) {
+		numThreads = std::max<size_t>(1, std::thread::hardware_concurrency());
+	}
+	numThreads = std::min(numThreads, paths.size());
+	std::atomic<size_t> next(0), numDecoded(0);
+	const auto worker = [&]() {
+		for (size_t index = next++; index < paths.size(); index = next++) {
+			if (alprDecodeFile(paths[index], files[index], wantedType, pool)) {
+				++numDecoded;
+			}
+		}
+	};
+	std::vector<std::thread> threads;
+	for (size_t t = 1; t < numThreads; ++t) {
+		threads.push_back(std::thread(worker));
+	}
+	worker();
+	for (std::thread& thread : threads) {
+		thread.join();
+	}
+	return numDecoded;
+}
+
+/*
+* Regular files under a directory, recursively, sorted
+* @param path Directory, or a single file which is then the only entry
+* @param files Receives the paths ('path' followed by the relative path)
+*/
+static bool alprListFiles(const std::string& path, std::vector<std::string>& files)
+{
+	struct stat st;
+	if (stat(path.c_str(), &st) != 0) {
+		ULTALPR_SDK_PRINT_ERROR("Failed to stat: %s", path.c_str());
+		return false;
+	}
+	if (!S_ISDIR(st.st_mode)) {
+		files.push_back(path);
+		return true;
+	}
+	DIR* dir = opendir(path.c_str());
+	if (!dir) {
+		ULTALPR_SDK_PRINT_ERROR("Failed to open directory: %s", path.c_str());
+		return false;
+	}
+	std::vector<std::string> entries;
+	while (struct dirent* entry = readdir(dir)) {
+		const std::string name = entry->d_name;
+		if (name != "." && name != "..") {
+			entries.push_back(path + (path.back() == '/' ? "" : "/") + name);
+		}
+	}
+	closedir(dir);
+	std::sort(entries.begin(), entries.end());
+	for (const std::string& entry : entries) {
+		if (stat(entry.c_str(), &st) != 0) {
+			continue;
+		}
+		if (S_ISDIR(st.st_mode)) {
+			alprListFiles(entry, files);
+		}
+		else if (S_ISREG(st.st_mode)) {
+			files.push_back(entry);
+		}
+	}
 	return true;
 }
 
@@ -0,0 +1,403 @@
+#if !defined(_ALPR_V4L2_H_)
+#define _ALPR_V4L2_H_
+
+#include <ultimateALPR-SDK-API-PUBLIC.h>
+#include <alpr_engine.h>
+#include <opencv2/core.hpp>
+#include <opencv2/imgproc.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <linux/videodev2.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/*
+* Native V4L2 capture: the driver fills mmap'ed buffers which are handed to the engine as they are,
+* without cv::VideoCapture nor BGR conversion on the way to the recognizer.
+*	- NV12: zero-copy, the Y and interleaved UV planes go to the planar process()
+*	- YUYV: the SDK has no packed 4:2:2 input -> the luma is extracted (one pass, half the size of the
+*		buffer) and processed as ULTALPR_SDK_IMAGE_TYPE_Y
+* A buffer belongs to the caller from dequeue() until requeue(), which must only be called once the
+* engine result is back (and the frame converted for display if needed).
+*
+* Single-planar API only (V4L2_BUF_TYPE_VIDEO_CAPTURE), which is what UVC cameras and the vivid
+* virtual driver expose. When the path is a regular file instead of a device, it is read as raw
+* frames in the requested format (e.g. made with ffmpeg -pix_fmt nv12 -f rawvideo) and mmap'ed:
+* same zero-copy path, without the hardware.
+*/
+struct AlprV4l2Frame {
+	int index = -1; // buffer to give back to requeue()
+	uint32_t fourcc = 0;
+	const uint8_t* data = nullptr;
+	size_t width = 0;
+	size_t height = 0;
+	size_t stride = 0; // bytes per line of the first plane
+	uint64_t timestampMicros = 0; // driver's capture time (monotonic clock)
+};
+
+class AlprV4l2Source {
+public:
+	AlprV4l2Source() : m_nFd(-1), m_bStreaming(false), m_bFile(false), m_bEnded(false), m_nFourcc(0),
+		m_nWidth(0), m_nHeight(0), m_nStride(0), m_nFrameSize(0), m_pFileData(nullptr), m_nFileSize(0), m_nNextFileFrame(0) {}
+	~AlprV4l2Source() {
+		close();
+	}
+
+	/*
+	* @param fourcc "NV12" or "YUYV"
+	* @param buffers Number of mmap'ed driver buffers, at least 2
+	* @param fps Requested frame rate, 0 for the driver's. For the file stand-in, the pace of dequeue().
+	*/
+	bool open(const std::string& path, const size_t width, const size_t height, const std::string& fourcc, const size_t buffers, const double fps = 0.0) {
+		if (fourcc != "NV12" && fourcc != "YUYV") {
+			ULTALPR_SDK_PRINT_ERROR("Unsupported V4L2 pixel format: %s (NV12 or YUYV)", fourcc.c_str());
+			return false;
+		}
+		m_nFourcc = v4l2_fourcc(fourcc[0], fourcc[1], fourcc[2], fourcc[3]);
+		m_nWidth = width;
+		m_nHeight = height;
+		m_dFps = fps;
+		struct stat info;
+		if (stat(path.c_str(), &info) == 0 && S_ISREG(info.st_mode)) {
+			return openFile(path, static_cast<size_t>(info.st_size), buffers);
+		}
+		return openDevice(path, buffers);
+	}
+
+	inline bool isOpen() const { return m_nFd >= 0; }
+	// End of the file stand-in or device error, dequeue() won't return frames anymore
+	inline bool ended() const { return m_bEnded; }
+
+	/*
+	* Waits up to 'timeoutMillis' for a frame. Returns false on timeout (ended() == false) or at the end.
+	*/
+	bool dequeue(AlprV4l2Frame& frame, const int timeoutMillis = 200) {
+		if (m_bFile) {
+			return dequeueFile(frame);
+		}
+		struct pollfd pfd = { m_nFd, POLLIN, 0 };
+		const int ready = poll(&pfd, 1, timeoutMillis);
+		if (ready <= 0) {
+			if (ready < 0 && errno != EINTR) {
+				m_bEnded = true;
+			}
+			return false;
+		}
+		struct v4l2_buffer buf;
+		memset(&buf, 0, sizeof(buf));
+		buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+		buf.memory = V4L2_MEMORY_MMAP;
+		if (xioctl(VIDIOC_DQBUF, &buf) < 0) {
+			if (errno != EAGAIN) {
+				ULTALPR_SDK_PRINT_ERROR("VIDIOC_DQBUF failed: %s", strerror(errno));
+				m_bEnded = true;
+			}
+			return false;
+		}
+		frame.index = static_cast<int>(buf.index);
+		frame.fourcc = m_nFourcc;
+		frame.data = static_cast<const uint8_t*>(m_Buffers[buf.index].first);
+		frame.width = m_nWidth;
+		frame.height = m_nHeight;
+		frame.stride = m_nStride;
+		frame.timestampMicros = static_cast<uint64_t>(buf.timestamp.tv_sec) * 1000000 + buf.timestamp.tv_usec;
+		return true;
+	}
+
+	// Gives the buffer back to the driver, 'frame' must not be used afterwards
+	bool requeue(AlprV4l2Frame& frame) {
+		if (frame.index < 0) {
+			return false;
+		}
+		bool ok = true;
+		if (!m_bFile) {
+			struct v4l2_buffer buf;
+			memset(&buf, 0, sizeof(buf));
+			buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+			buf.memory = V4L2_MEMORY_MMAP;
+			buf.index = static_cast<uint32_t>(frame.index);
+			if (xioctl(VIDIOC_QBUF, &buf) < 0) {
+				ULTALPR_SDK_PRINT_ERROR("VIDIOC_QBUF failed: %s", strerror(errno));
+				ok = false;
+			}
+		}
+		frame.index = -1;
+		frame.data = nullptr;
+		return ok;
+	}
+
+	// Frames already captured and waiting in the driver's queue, i.e. how far behind the camera we are
+	size_t pendingFrames() {
+		if (m_bFile) {
+			if (m_dFps <= 0 || !m_bFileStarted) {
+				return 0;
+			}
+			const size_t due = dueFileFrame();
+			return due > m_nNextFileFrame ? std::min(due - m_nNextFileFrame, m_nNumFileBuffers) : 0;
+		}
+		size_t pending = 0;
+		for (size_t i = 0; i < m_Buffers.size(); ++i) {
+			struct v4l2_buffer buf;
+			memset(&buf, 0, sizeof(buf));
+			buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+			buf.memory = V4L2_MEMORY_MMAP;
+			buf.index = static_cast<uint32_t>(i);
+			if (xioctl(VIDIOC_QUERYBUF, &buf) == 0 && (buf.flags & V4L2_BUF_FLAG_DONE)) {
+				++pending;
+			}
+		}
+		return pending;
+	}
+
+	// Recognition straight from the driver's buffer
+	AlprEngineResult process(AlprEngine& engine, const AlprV4l2Frame& frame) {
+		if (frame.fourcc == V4L2_PIX_FMT_NV12) {
+			const uint8_t* uv = frame.data + frame.stride * frame.height;
+			return engine.process(
+				ULTALPR_SDK_IMAGE_TYPE_NV12,
+				frame.data,
+				uv,
+				uv + 1,
+				frame.width,
+				frame.height,
+				frame.stride,
+				frame.stride,
+				frame.stride,
+				2
+			);
+		}
+		// YUYV: Y0 U0 Y1 V0...
+		m_Luma.resize(frame.width * frame.height);
+		for (size_t y = 0; y < frame.height; ++y) {
+			const uint8_t* src = frame.data + y * frame.stride;
+			uint8_t* dst = &m_Luma[y * frame.width];
+			for (size_t x = 0; x < frame.width; ++x) {
+				dst[x] = src[x << 1];
+			}
+		}
+		return engine.process(
+			ULTALPR_SDK_IMAGE_TYPE_Y,
+			m_Luma.data(),
+			frame.width,
+			frame.height
+		);
+	}
+
+	// BGR copy for the overlay, the display and the output video
+	static void toBgr(const AlprV4l2Frame& frame, cv::Mat& bgr) {
+		if (frame.fourcc == V4L2_PIX_FMT_NV12) {
+			const cv::Mat yuv(static_cast<int>(frame.height * 3 / 2), static_cast<int>(frame.width), CV_8UC1, const_cast<uint8_t*>(frame.data), frame.stride);
+			cv::cvtColor(yuv, bgr, cv::COLOR_YUV2BGR_NV12);
+		}
+		else {
+			const cv::Mat yuv(static_cast<int>(frame.height), static_cast<int>(frame.width), CV_8UC2, const_cast<uint8_t*>(frame.data), frame.stride);
+			cv::cvtColor(yuv, bgr, cv::COLOR_YUV2BGR_YUYV);
+		}
+	}
+
+	void close() {
+		if (m_bStreaming) {
+			enum v4l2_buf_type type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+			xioctl(VIDIOC_STREAMOFF, &type);
+			m_bStreaming = false;
+		}
+		for (size_t i = 0; i < m_Buffers.size(); ++i) {
+			munmap(m_Buffers[i].first, m_Buffers[i].second);
+		}
+		m_Buffers.clear();
+		if (m_pFileData) {
+			munmap(m_pFileData, m_nFileSize);
+			m_pFileData = nullptr;
+		}
+		if (m_nFd >= 0) {
+			::close(m_nFd);
+			m_nFd = -1;
+		}
+	}
+
+private:
+	int xioctl(const unsigned long request, void* arg) {
+		int ret;
+		do {
+			ret = ioctl(m_nFd, request, arg);
+		} while (ret < 0 && errno == EINTR);
+		return ret;
+	}
+
+	bool openDevice(const std::string& path, size_t buffers) {
+		m_nFd = ::open(path.c_str(), O_RDWR | O_NONBLOCK);
+		if (m_nFd < 0) {
+			ULTALPR_SDK_PRINT_ERROR("Failed to open %s: %s", path.c_str(), strerror(errno));
+			return false;
+		}
+		struct v4l2_capability cap;
+		memset(&cap, 0, sizeof(cap));
+		if (xioctl(VIDIOC_QUERYCAP, &cap) < 0 || !(cap.capabilities & V4L2_CAP_VIDEO_CAPTURE) || !(cap.capabilities & V4L2_CAP_STREAMING)) {
+			ULTALPR_SDK_PRINT_ERROR("%s is not a single-planar V4L2 capture device with streaming I/O", path.c_str());
+			close();
+			return false;
+		}
+		struct v4l2_format fmt;
+		memset(&fmt, 0, sizeof(fmt));
+		fmt.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+		fmt.fmt.pix.width = static_cast<uint32_t>(m_nWidth);
+		fmt.fmt.pix.height = static_cast<uint32_t>(m_nHeight);
+		fmt.fmt.pix.pixelformat = m_nFourcc;
+		fmt.fmt.pix.field = V4L2_FIELD_NONE;
+		if (xioctl(VIDIOC_S_FMT, &fmt) < 0 || fmt.fmt.pix.pixelformat != m_nFourcc) {
+			ULTALPR_SDK_PRINT_ERROR("%s doesn't support the requested pixel format", path.c_str());
+			close();
+			return false;
+		}
+		// The driver may have picked the closest size
+		m_nWidth = fmt.fmt.pix.width;
+		m_nHeight = fmt.fmt.pix.height;
+		m_nStride = fmt.fmt.pix.bytesperline;
+		if (m_dFps > 0) {
+			struct v4l2_streamparm parm;
+			memset(&parm, 0, sizeof(parm));
+			parm.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+			parm.parm.capture.timeperframe.numerator = 1000;
+			parm.parm.capture.timeperframe.denominator = static_cast<uint32_t>(m_dFps * 1000);
+			xioctl(VIDIOC_S_PARM, &parm); // best effort
+		}
+
+		struct v4l2_requestbuffers req;
+		memset(&req, 0, sizeof(req));
+		req.count = static_cast<uint32_t>(buffers < 2 ? 2 : buffers);
+		req.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+		req.memory = V4L2_MEMORY_MMAP;
+		if (xioctl(VIDIOC_REQBUFS, &req) < 0 || req.count < 2) {
+			ULTALPR_SDK_PRINT_ERROR("VIDIOC_REQBUFS failed: %s", strerror(errno));
+			close();
+			return false;
+		}
+		for (uint32_t i = 0; i < req.count; ++i) {
+			struct v4l2_buffer buf;
+			memset(&buf, 0, sizeof(buf));
+			buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+			buf.memory = V4L2_MEMORY_MMAP;
+			buf.index = i;
+			if (xioctl(VIDIOC_QUERYBUF, &buf) < 0) {
+				close();
+				return false;
+			}
+			void* start = mmap(nullptr, buf.length, PROT_READ | PROT_WRITE, MAP_SHARED, m_nFd, buf.m.offset);
+			if (start == MAP_FAILED) {
+				ULTALPR_SDK_PRINT_ERROR("mmap failed: %s", strerror(errno));
+				close();
+				return false;
+			}
+			m_Buffers.push_back(std::make_pair(start, static_cast<size_t>(buf.length)));
+			if (xioctl(VIDIOC_QBUF, &buf) < 0) {
+				close();
+				return false;
+			}
+		}
+		enum v4l2_buf_type type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+		if (xioctl(VIDIOC_STREAMON, &type) < 0) {
+			ULTALPR_SDK_PRINT_ERROR("VIDIOC_STREAMON failed: %s", strerror(errno));
+			close();
+			return false;
+		}
+		m_bStreaming = true;
+		ULTALPR_SDK_PRINT_INFO("V4L2 %s: %zux%zu, stride %zu, %zu mmap'ed buffers", path.c_str(), m_nWidth, m_nHeight, m_nStride, m_Buffers.size());
+		return true;
+	}
+
+	bool openFile(const std::string& path, const size_t size, const size_t buffers) {
+		m_bFile = true;
+		m_nStride = (m_nFourcc == V4L2_PIX_FMT_NV12) ? m_nWidth : (m_nWidth * 2);
+		m_nFrameSize = (m_nFourcc == V4L2_PIX_FMT_NV12) ? (m_nStride * m_nHeight * 3 / 2) : (m_nStride * m_nHeight);
+		if (size < m_nFrameSize) {
+			ULTALPR_SDK_PRINT_ERROR("%s is smaller than one %zux%zu frame", path.c_str(), m_nWidth, m_nHeight);
+			return false;
+		}
+		m_nFd = ::open(path.c_str(), O_RDONLY);
+		if (m_nFd < 0) {
+			ULTALPR_SDK_PRINT_ERROR("Failed to open %s: %s", path.c_str(), strerror(errno));
+			return false;
+		}
+		m_nFileSize = size;
+		m_pFileData = mmap(nullptr, m_nFileSize, PROT_READ, MAP_PRIVATE, m_nFd, 0);
+		if (m_pFileData == MAP_FAILED) {
+			m_pFileData = nullptr;
+			ULTALPR_SDK_PRINT_ERROR("mmap failed: %s", strerror(errno));
+			close();
+			return false;
+		}
+		madvise(m_pFileData, m_nFileSize, MADV_SEQUENTIAL);
+		m_nNumFileBuffers = buffers < 2 ? 2 : buffers;
+		ULTALPR_SDK_PRINT_INFO("V4L2 stand-in %s: %zu raw %zux%zu frames", path.c_str(), m_nFileSize / m_nFrameSize, m_nWidth, m_nHeight);
+		return true;
+	}
+
+	// Index of the frame the camera would be capturing now, when paced
+	size_t dueFileFrame() const {
+		const int64_t elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - m_FileStart).count();
+		return static_cast<size_t>(elapsed * m_dFps / 1e6);
+	}
+
+	/*
+	* Paced like a camera: frame n is captured at start + n / fps. Like the driver, when all the
+	* buffers are full the oldest frames are lost.
+	*/
+	bool dequeueFile(AlprV4l2Frame& frame) {
+		std::chrono::steady_clock::time_point captured = std::chrono::steady_clock::now();
+		if (m_dFps > 0) {
+			if (!m_bFileStarted) {
+				m_FileStart = captured;
+				m_bFileStarted = true;
+			}
+			const size_t due = dueFileFrame();
+			if (due > m_nNextFileFrame + m_nNumFileBuffers) {
+				m_nNextFileFrame = due - m_nNumFileBuffers;
+			}
+			captured = m_FileStart + std::chrono::microseconds(static_cast<int64_t>(m_nNextFileFrame * 1e6 / m_dFps));
+			std::this_thread::sleep_until(captured);
+		}
+		if ((m_nNextFileFrame + 1) * m_nFrameSize > m_nFileSize) {
+			m_bEnded = true;
+			return false;
+		}
+		frame.index = static_cast<int>(m_nNextFileFrame % m_nNumFileBuffers);
+		frame.fourcc = m_nFourcc;
+		frame.data = static_cast<const uint8_t*>(m_pFileData) + m_nNextFileFrame * m_nFrameSize;
+		frame.width = m_nWidth;
+		frame.height = m_nHeight;
+		frame.stride = m_nStride;
+		frame.timestampMicros = std::chrono::duration_cast<std::chrono::microseconds>(captured.time_since_epoch()).count();
+		++m_nNextFileFrame;
+		return true;
+	}
+
+	int m_nFd;
+	bool m_bStreaming;
+	bool m_bFile;
+	bool m_bEnded;
+	uint32_t m_nFourcc;
+	size_t m_nWidth, m_nHeight, m_nStride, m_nFrameSize;
+	double m_dFps = 0.0;
+	std::vector<std::pair<void*, size_t> > m_Buffers;
+	std::vector<uint8_t> m_Luma;
+
+	void* m_pFileData;
+	size_t m_nFileSize;
+	size_t m_nNextFileFrame;
+	size_t m_nNumFileBuffers = 2;
+	bool m_bFileStarted = false;
+	std::chrono::steady_clock::time_point m_FileStart;
+};
+
+#endif /* _ALPR_V4L2_H_ */
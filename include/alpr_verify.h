@@ -0,0 +1,114 @@
+#if !defined(_ALPR_VERIFY_H_)
+#define _ALPR_VERIFY_H_
+
+#include <ultimateALPR-SDK-API-PUBLIC.h>
+#include <alpr_watchlist.h>
+#include <alpr_metrics.h>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+/*
+* Verification of the confirmed plates against the watchlist:
+*	"deny" (the default): alarm when the plate is registered, e.g. a list of stolen vehicles
+*	"allow": alarm when the plate is NOT registered, e.g. the residents of a gated site
+* Every registered plate confirmed at least once is marked in a bitset indexed by its watchlist ordinal
+* (one bit per entry, 125 KB for a million plates): marking is O(1) and the coverage report, the
+* registered plates never seen, is a scan of the bitset skipping the words already full.
+*/
+class AlprVerifier {
+public:
+	AlprVerifier(const AlprWatchlist& watchlist, const bool allowlist = false)
+		: m_Watchlist(watchlist), m_bAllowlist(allowlist), m_Seen((watchlist.size() + 63) / 64, 0), m_nNumSeen(0), m_nReportIntervalMicros(0) {}
+
+	/*
+	* Coverage report written to 'path' every 'intervalSeconds' (see tick()) and by flush(), nothing when 'path' is empty
+	*/
+	void setReport(const std::string& path, const double intervalSeconds) {
+		m_strReportPath = path;
+		m_nReportIntervalMicros = static_cast<uint64_t>(intervalSeconds * 1e6);
+		m_LastReport = AlprClock::now();
+	}
+
+	// Once per frame, cheap when the report is not due
+	inline void tick() {
+		if (m_nReportIntervalMicros && !m_strReportPath.empty() && alprMicrosSince(m_LastReport) >= m_nReportIntervalMicros) {
+			m_LastReport = AlprClock::now();
+			writeReport(m_strReportPath);
+		}
+	}
+
+	inline void flush() {
+		if (!m_strReportPath.empty()) {
+			writeReport(m_strReportPath);
+		}
+	}
+
+	inline const AlprWatchlist& watchlist() const { return m_Watchlist; }
+	inline bool allowlist() const { return m_bAllowlist; }
+	inline size_t numSeen() const { return m_nNumSeen; }
+
+	/*
+	* To be called for each confirmed plate. Returns true when it must raise an alert.
+	* 'entry' receives the category and priority of a registered plate, zeros otherwise.
+	*/
+	bool check(const std::string& plate, AlprWatchlistEntry& entry) {
+		entry = AlprWatchlistEntry();
+		const bool registered = m_Watchlist.find(plate, &entry);
+		if (registered) {
+			uint64_t& word = m_Seen[entry.ordinal >> 6];
+			const uint64_t bit = 1ULL << (entry.ordinal & 63);
+			if (!(word & bit)) {
+				word |= bit;
+				++m_nNumSeen;
+			}
+		}
+		return registered != m_bAllowlist;
+	}
+
+	/*
+	* Writes the registered plates never seen, one per line after a summary comment.
+	* Written next to 'path' then renamed, a reader never sees a partial report.
+	*/
+	bool writeReport(const std::string& path) const {
+		const std::string tmpPath = path + ".tmp";
+		std::ofstream report(tmpPath.c_str());
+		if (!report) {
+			ULTALPR_SDK_PRINT_ERROR("Failed to create coverage report: %s", tmpPath.c_str());
+			return false;
+		}
+		const size_t numPlates = m_Watchlist.size();
+		report << "# " << m_nNumSeen << " of " << numPlates << " registered plates seen, " << (numPlates - m_nNumSeen) << " never seen\n";
+		for (size_t w = 0; w < m_Seen.size(); ++w) {
+			uint64_t unseen = ~m_Seen[w];
+			if ((w + 1) * 64 > numPlates) {
+				unseen &= (numPlates % 64) ? ((1ULL << (numPlates % 64)) - 1) : ~0ULL; // past the last entry
+			}
+			while (unseen) {
+				const int bit = __builtin_ctzll(unseen);
+				report << m_Watchlist.plate(w * 64 + bit) << "\n";
+				unseen &= unseen - 1;
+			}
+		}
+		report.close();
+		if (!report || std::rename(tmpPath.c_str(), path.c_str()) != 0) {
+			ULTALPR_SDK_PRINT_ERROR("Failed to write coverage report: %s", path.c_str());
+			std::remove(tmpPath.c_str());
+			return false;
+		}
+		return true;
+	}
+
+private:
+	const AlprWatchlist& m_Watchlist;
+	bool m_bAllowlist;
+	std::vector<uint64_t> m_Seen;
+	size_t m_nNumSeen;
+	std::string m_strReportPath;
+	uint64_t m_nReportIntervalMicros;
+	AlprClock::time_point m_LastReport;
+};
+
+#endif /* _ALPR_VERIFY_H_ */
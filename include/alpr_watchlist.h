@@ -0,0 +1,573 @@
+#if !defined(_ALPR_WATCHLIST_H_)
+#define _ALPR_WATCHLIST_H_
+
+#include <ultimateALPR-SDK-API-PUBLIC.h>
+#include <alpr_pipeline.h>
+#include <alpr_bloom.h>
+#include <alpr_metrics.h>
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/*
+* Category and priority of a watchlist entry. Category 0 is "no category", the names are in AlprWatchlist::categoryName().
+* The ordinal numbers the entries from 0 to size() - 1 (see AlprWatchlist::plate()).
+*/
+struct AlprWatchlistEntry {
+	uint8_t category = 0;
+	uint8_t priority = 0;
+	uint32_t ordinal = 0;
+};
+
+/*
+* One line of a text watchlist before compilation
+*/
+struct AlprWatchlistRecord {
+	std::string plate;
+	std::string category;
+	int priority = 0;
+};
+
+/*
+* Text entries are "PLATE[,CATEGORY[,PRIORITY]]" separated by white spaces, e.g. "ABC1234,stolen,3".
+* A bare plate (the historical registered.txt format) has no category and priority 0.
+* The plate is normalized like the recognized ones (see alprNormalizePlate).
+*/
+static bool alprWatchlistParseRecord(const std::string& token, AlprWatchlistRecord& record)
+{
+	const size_t comma1 = token.find(',');
+	const size_t comma2 = (comma1 == std::string::npos) ? std::string::npos : token.find(',', comma1 + 1);
+	record.plate = token.substr(0, comma1);
+	record.category = (comma1 == std::string::npos) ? "" : token.substr(comma1 + 1, comma2 - comma1 - 1);
+	record.priority = (comma2 == std::string::npos) ? 0 : std::atoi(token.c_str() + comma2 + 1);
+	alprNormalizePlate(record.plate);
+	return !record.plate.empty() && record.priority >= 0 && record.priority <= 255;
+}
+
+/*
+* Plates packed into 64-bit keys, 6 bits per character ('0'-'9' -> 1-10, 'A'-'Z' -> 11-36), the first
+* character in the most significant bits and zero padded: the keys sort like the plates. Up to 10 characters.
+*/
+static bool alprWatchlistPack(const std::string& plate, uint64_t& key)
+{
+	if (plate.empty() || plate.size() > 10) {
+		return false;
+	}
+	key = 0;
+	for (size_t i = 0; i < 10; ++i) {
+		uint64_t code = 0;
+		if (i < plate.size()) {
+			const char c = plate[i];
+			if (c >= '0' && c <= '9') code = 1 + (c - '0');
+			else if (c >= 'A' && c <= 'Z') code = 11 + (c - 'A');
+			else return false;
+		}
+		key = (key << 6) | code;
+	}
+	return true;
+}
+
+static std::string alprWatchlistUnpack(uint64_t key)
+{
+	std::string plate;
+	for (int i = 9; i >= 0; --i) {
+		const uint64_t code = (key >> (6 * i)) & 0x3f;
+		if (code >= 11) plate += static_cast<char>('A' + (code - 11));
+		else if (code >= 1) plate += static_cast<char>('0' + (code - 1));
+	}
+	return plate;
+}
+
+static inline uint64_t alprWatchlistHash(uint64_t key, const uint64_t seed)
+{
+	// splitmix64 finalizer
+	key += seed * 0x9e3779b97f4a7c15ULL + 0x9e3779b97f4a7c15ULL;
+	key = (key ^ (key >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	key = (key ^ (key >> 27)) * 0x94d049bb133111ebULL;
+	return key ^ (key >> 31);
+}
+
+/*
+* Key of a plate in the Bloom filter: the mixed packed key, or a string hash for the (text list only) plates that can't be packed
+*/
+static inline uint64_t alprWatchlistFilterHash(const uint64_t key)
+{
+	return alprWatchlistHash(key, 0xb100f);
+}
+
+static inline uint64_t alprWatchlistFilterHash(const std::string& plate)
+{
+	uint64_t key;
+	return alprWatchlistFilterHash(alprWatchlistPack(plate, key) ? key : std::hash<std::string>()(plate));
+}
+
+/*
+* Compiled watchlist, host byte order, all sections 8-byte aligned:
+*	header (64 bytes)
+*	keys: uint64_t[count], ascending
+*	attributes: uint16_t[count], (category << 8) | priority
+*	category names: char[32][numCategories], NUL padded, index 0 is ""
+*	with the perfect hash (flags & 1): displacements uint32_t[numBuckets] then slots uint32_t[tableSize]
+*	with the Bloom filter (flags & 2): zero padding up to a 64-byte offset then the filter blocks, uint32_t[8] each [numFilterBlocks]
+* Without the perfect hash a lookup is a binary search on the keys, with it a lookup is two hashes and
+* one key compare (hash and displace: bucket = h(key, 0) % numBuckets, slot = h(key, disp[bucket]) % tableSize).
+*/
+#define ALPR_WATCHLIST_MAGIC "ALPRWL01"
+#define ALPR_WATCHLIST_BYTE_ORDER 0x01020304U
+#define ALPR_WATCHLIST_FLAG_PERFECT_HASH 1U
+#define ALPR_WATCHLIST_FLAG_FILTER 2U
+#define ALPR_WATCHLIST_CATEGORY_SIZE 32
+
+struct AlprWatchlistHeader {
+	char magic[8];
+	uint32_t byteOrder;
+	uint32_t flags;
+	uint64_t count;
+	uint64_t numBuckets;
+	uint64_t tableSize;
+	uint32_t numCategories;
+	uint32_t numFilterBlocks; // 0 in the files written before the filter was stored, it is then built at load time
+	uint32_t reserved[4];
+};
+
+static inline size_t alprWatchlistAlign(const size_t size)
+{
+	return (size + 7) & ~static_cast<size_t>(7);
+}
+
+static inline size_t alprWatchlistFilterPadding(const size_t offset)
+{
+	return (64 - (offset & 63)) & 63; // the filter blocks start on a cache line
+}
+
+static bool alprWatchlistBuildPerfectHash(const std::vector<uint64_t>& keys, uint64_t& numBuckets, uint64_t& tableSize,
+	std::vector<uint32_t>& disp, std::vector<uint32_t>& slots)
+{
+	const size_t n = keys.size();
+	numBuckets = n / 4 + 1;
+	tableSize = n + n / 4 + 1;
+	std::vector<std::vector<uint32_t> > buckets(numBuckets);
+	for (size_t i = 0; i < n; ++i) {
+		buckets[alprWatchlistHash(keys[i], 0) % numBuckets].push_back(static_cast<uint32_t>(i));
+	}
+	std::vector<uint32_t> order(numBuckets);
+	for (size_t b = 0; b < numBuckets; ++b) {
+		order[b] = static_cast<uint32_t>(b);
+	}
+	std::stable_sort(order.begin(), order.end(), [&buckets](const uint32_t a, const uint32_t b) {
+		return buckets[a].size() > buckets[b].size();
+	});
+	for (int attempt = 0; attempt < 8; ++attempt) {
+		disp.assign(numBuckets, 0);
+		slots.assign(tableSize, UINT32_MAX);
+		bool failed = false;
+		std::vector<uint64_t> candidate;
+		for (const uint32_t b : order) {
+			if (buckets[b].empty()) {
+				break;
+			}
+			bool placed = false;
+			for (uint32_t d = 1; d < (1U << 20) && !placed; ++d) {
+				candidate.clear();
+				placed = true;
+				for (const uint32_t i : buckets[b]) {
+					const uint64_t slot = alprWatchlistHash(keys[i], d) % tableSize;
+					if (slots[slot] != UINT32_MAX || std::find(candidate.begin(), candidate.end(), slot) != candidate.end()) {
+						placed = false;
+						break;
+					}
+					candidate.push_back(slot);
+				}
+				if (placed) {
+					for (size_t j = 0; j < candidate.size(); ++j) {
+						slots[candidate[j]] = buckets[b][j];
+					}
+					disp[b] = d;
+				}
+			}
+			if (!placed) {
+				failed = true;
+				break;
+			}
+		}
+		if (!failed) {
+			return true;
+		}
+		tableSize += tableSize / 8 + 1; // more room, try again
+	}
+	return false;
+}
+
+/*
+* Compiles text records into the binary format. Plates that can't be packed are skipped with a warning,
+* duplicates keep the highest priority (the first one on a tie). At most 255 categories.
+* Only the packed keys are kept in memory (16 bytes per plate), the records may be streamed in.
+*/
+class AlprWatchlistCompiler {
+public:
+	AlprWatchlistCompiler() : m_nNumSkipped(0) {
+		m_Categories.push_back("");
+	}
+
+	// False when the category can't be added (too many of them), skipped plates are only counted
+	bool add(const AlprWatchlistRecord& record) {
+		std::pair<uint64_t, AlprWatchlistEntry> entry;
+		if (!alprWatchlistPack(record.plate, entry.first) || record.category.size() >= ALPR_WATCHLIST_CATEGORY_SIZE) {
+			if (m_nNumSkipped++ < 10) {
+				ULTALPR_SDK_PRINT_WARN("Skipping watchlist entry '%s' (plate up to 10 characters within 0-9 A-Z, category up to %d characters)",
+					record.plate.c_str(), ALPR_WATCHLIST_CATEGORY_SIZE - 1);
+			}
+			return true;
+		}
+		std::vector<std::string>::const_iterator category = std::find(m_Categories.begin(), m_Categories.end(), record.category);
+		if (category == m_Categories.end()) {
+			if (m_Categories.size() > 255) {
+				ULTALPR_SDK_PRINT_ERROR("Too many watchlist categories (255 max)");
+				return false;
+			}
+			category = m_Categories.insert(m_Categories.end(), record.category);
+		}
+		entry.second.category = static_cast<uint8_t>(category - m_Categories.begin());
+		entry.second.priority = static_cast<uint8_t>(record.priority);
+		m_Entries.push_back(entry);
+		return true;
+	}
+
+	inline size_t numSkipped() const { return m_nNumSkipped; }
+
+	bool write(const std::string& path, const bool perfectHash) {
+		if (m_nNumSkipped) {
+			ULTALPR_SDK_PRINT_WARN("%zu watchlist entries skipped", m_nNumSkipped);
+		}
+		std::stable_sort(m_Entries.begin(), m_Entries.end(), [](const std::pair<uint64_t, AlprWatchlistEntry>& a, const std::pair<uint64_t, AlprWatchlistEntry>& b) {
+			return a.first < b.first || (a.first == b.first && a.second.priority > b.second.priority);
+		});
+		m_Entries.erase(std::unique(m_Entries.begin(), m_Entries.end(), [](const std::pair<uint64_t, AlprWatchlistEntry>& a, const std::pair<uint64_t, AlprWatchlistEntry>& b) {
+			return a.first == b.first;
+		}), m_Entries.end());
+		std::vector<uint64_t> keys(m_Entries.size());
+		std::vector<uint16_t> attributes(m_Entries.size());
+		for (size_t i = 0; i < m_Entries.size(); ++i) {
+			keys[i] = m_Entries[i].first;
+			attributes[i] = static_cast<uint16_t>((m_Entries[i].second.category << 8) | m_Entries[i].second.priority);
+		}
+		AlprWatchlistHeader header;
+		std::memset(&header, 0, sizeof(header));
+		std::memcpy(header.magic, ALPR_WATCHLIST_MAGIC, sizeof(header.magic));
+		header.byteOrder = ALPR_WATCHLIST_BYTE_ORDER;
+		header.count = keys.size();
+		header.numCategories = static_cast<uint32_t>(m_Categories.size());
+		std::vector<uint32_t> disp, slots;
+		if (perfectHash && !keys.empty()) {
+			if (!alprWatchlistBuildPerfectHash(keys, header.numBuckets, header.tableSize, disp, slots)) {
+				ULTALPR_SDK_PRINT_ERROR("Failed to build the perfect hash");
+				return false;
+			}
+			header.flags |= ALPR_WATCHLIST_FLAG_PERFECT_HASH;
+		}
+		AlprBloomFilter filter;
+		filter.init(keys.size());
+		for (const uint64_t key : keys) {
+			filter.insert(alprWatchlistFilterHash(key));
+		}
+		if (filter.enabled()) {
+			header.flags |= ALPR_WATCHLIST_FLAG_FILTER;
+			header.numFilterBlocks = static_cast<uint32_t>(filter.sizeInBytes() / AlprBloomFilter::kBlockSize);
+		}
+
+		// Written next to the destination then renamed, processes mapping the old file keep it
+		const std::string tmpPath = path + ".tmp";
+		std::ofstream file(tmpPath.c_str(), std::ios::binary | std::ios::trunc);
+		if (!file) {
+			ULTALPR_SDK_PRINT_ERROR("Failed to create %s", tmpPath.c_str());
+			return false;
+		}
+		const char padding[64] = { 0 };
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		file.write(reinterpret_cast<const char*>(keys.data()), keys.size() * sizeof(uint64_t));
+		file.write(reinterpret_cast<const char*>(attributes.data()), attributes.size() * sizeof(uint16_t));
+		file.write(padding, alprWatchlistAlign(attributes.size() * sizeof(uint16_t)) - attributes.size() * sizeof(uint16_t));
+		for (const std::string& category : m_Categories) {
+			char name[ALPR_WATCHLIST_CATEGORY_SIZE] = { 0 };
+			std::memcpy(name, category.c_str(), category.size());
+			file.write(name, sizeof(name));
+		}
+		file.write(reinterpret_cast<const char*>(disp.data()), disp.size() * sizeof(uint32_t));
+		file.write(padding, alprWatchlistAlign(disp.size() * sizeof(uint32_t)) - disp.size() * sizeof(uint32_t));
+		file.write(reinterpret_cast<const char*>(slots.data()), slots.size() * sizeof(uint32_t));
+		if (filter.enabled()) {
+			file.write(padding, alprWatchlistFilterPadding(static_cast<size_t>(file.tellp())));
+			file.write(static_cast<const char*>(filter.data()), filter.sizeInBytes());
+		}
+		file.close();
+		if (!file || std::rename(tmpPath.c_str(), path.c_str()) != 0) {
+			ULTALPR_SDK_PRINT_ERROR("Failed to write %s", path.c_str());
+			std::remove(tmpPath.c_str());
+			return false;
+		}
+		ULTALPR_SDK_PRINT_INFO("%s: %zu plates, %zu categories%s", path.c_str(), keys.size(), m_Categories.size() - 1,
+			(header.flags & ALPR_WATCHLIST_FLAG_PERFECT_HASH) ? ", perfect hash" : "");
+		return true;
+	}
+
+private:
+	std::vector<std::string> m_Categories;
+	std::vector<std::pair<uint64_t, AlprWatchlistEntry> > m_Entries;
+	size_t m_nNumSkipped;
+};
+
+/*
+* Registered plates, either a text list (registered.txt) or a compiled one (see the watchlist tool).
+* The compiled list is mmap'ed read-only: nothing to parse at startup and the pages are shared by all the
+* processes on the host using the same file.
+* Nearly every plate looked up is not on the list: a Bloom filter (12 bits per plate, one cache line per probe)
+* answers most of them without touching the index. It is built at load time for the text lists and stored in
+* the compiled ones, where it is mapped like the rest of the file.
+*/
+class AlprWatchlist {
+public:
+	AlprWatchlist() : m_pMap(nullptr), m_nMapSize(0), m_pHeader(nullptr), m_pKeys(nullptr), m_pAttributes(nullptr),
+		m_pDisp(nullptr), m_pSlots(nullptr), m_pFilteredCounter(nullptr), m_pHitCounter(nullptr), m_pFalsePositiveCounter(nullptr) {
+		m_Categories.push_back("");
+	}
+	~AlprWatchlist() {
+		if (m_pMap) {
+			munmap(m_pMap, m_nMapSize);
+		}
+	}
+
+	/*
+	* Compiled or text list, depending on the first bytes of the file
+	*/
+	bool load(const std::string& path) {
+		char magic[8] = { 0 };
+		std::ifstream file(path.c_str(), std::ios::binary);
+		if (file.read(magic, sizeof(magic)) && std::memcmp(magic, ALPR_WATCHLIST_MAGIC, sizeof(magic)) == 0) {
+			return loadBinary(path);
+		}
+		return loadText(path);
+	}
+
+	bool loadText(const std::string& path) {
+		std::ifstream registered(path.c_str());
+		if (!registered) {
+			ULTALPR_SDK_PRINT_WARN("Failed to open watchlist: %s", path.c_str());
+			return false;
+		}
+		std::string buff;
+		AlprWatchlistRecord record;
+		while (registered >> buff) {
+			if (!alprWatchlistParseRecord(buff, record)) {
+				continue;
+			}
+			std::vector<std::string>::iterator category = std::find(m_Categories.begin(), m_Categories.end(), record.category);
+			if (category == m_Categories.end() && m_Categories.size() <= 255) {
+				category = m_Categories.insert(m_Categories.end(), record.category);
+			}
+			AlprWatchlistEntry entry;
+			entry.category = (category == m_Categories.end()) ? 0 : static_cast<uint8_t>(category - m_Categories.begin());
+			entry.priority = static_cast<uint8_t>(record.priority);
+			std::unordered_map<std::string, AlprWatchlistEntry>::iterator it = m_Plates.find(record.plate);
+			if (it == m_Plates.end()) {
+				entry.ordinal = static_cast<uint32_t>(m_Ordinals.size());
+				m_Ordinals.push_back(&m_Plates.insert(std::make_pair(record.plate, entry)).first->first);
+			}
+			else if (it->second.priority < entry.priority) {
+				entry.ordinal = it->second.ordinal;
+				it->second = entry;
+			}
+		}
+		ULTALPR_SDK_PRINT_INFO("Watchlist %s: %zu plates", path.c_str(), m_Plates.size());
+		m_Filter.init(m_Plates.size());
+		for (const std::pair<const std::string, AlprWatchlistEntry>& plate : m_Plates) {
+			m_Filter.insert(alprWatchlistFilterHash(plate.first));
+		}
+		logFilter();
+		return true;
+	}
+
+	bool loadBinary(const std::string& path) {
+		const int fd = ::open(path.c_str(), O_RDONLY);
+		struct stat st;
+		if (fd < 0 || fstat(fd, &st) != 0) {
+			ULTALPR_SDK_PRINT_WARN("Failed to open watchlist: %s", path.c_str());
+			if (fd >= 0) ::close(fd);
+			return false;
+		}
+		void* map = (st.st_size >= static_cast<off_t>(sizeof(AlprWatchlistHeader)))
+			? mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_SHARED, fd, 0) : MAP_FAILED;
+		::close(fd); // the mapping keeps the file
+		if (map == MAP_FAILED) {
+			ULTALPR_SDK_PRINT_WARN("Failed to map watchlist: %s", path.c_str());
+			return false;
+		}
+		const AlprWatchlistHeader* header = static_cast<const AlprWatchlistHeader*>(map);
+		const size_t keysSize = header->count * sizeof(uint64_t);
+		const size_t attributesSize = alprWatchlistAlign(header->count * sizeof(uint16_t));
+		const size_t categoriesSize = header->numCategories * ALPR_WATCHLIST_CATEGORY_SIZE;
+		const size_t dispSize = alprWatchlistAlign(header->numBuckets * sizeof(uint32_t));
+		const size_t slotsSize = header->tableSize * sizeof(uint32_t);
+		const bool perfectHash = (header->flags & ALPR_WATCHLIST_FLAG_PERFECT_HASH) != 0;
+		const bool storedFilter = (header->flags & ALPR_WATCHLIST_FLAG_FILTER) != 0;
+		const size_t filterOffset = sizeof(AlprWatchlistHeader) + keysSize + attributesSize + categoriesSize + dispSize + slotsSize;
+		const size_t filterSize = storedFilter ? alprWatchlistFilterPadding(filterOffset) + header->numFilterBlocks * AlprBloomFilter::kBlockSize : 0;
+		if (std::memcmp(header->magic, ALPR_WATCHLIST_MAGIC, sizeof(header->magic)) != 0 || header->byteOrder != ALPR_WATCHLIST_BYTE_ORDER
+			|| header->numCategories < 1 || header->numCategories > 256 || (perfectHash && (!header->numBuckets || !header->tableSize))
+			|| (storedFilter && header->numFilterBlocks != AlprBloomFilter::numBlocksFor(static_cast<size_t>(header->count)))
+			|| filterOffset + filterSize != static_cast<size_t>(st.st_size)) {
+			ULTALPR_SDK_PRINT_ERROR("%s: not a watchlist compiled on this platform, or truncated", path.c_str());
+			munmap(map, static_cast<size_t>(st.st_size));
+			return false;
+		}
+		madvise(map, static_cast<size_t>(st.st_size), MADV_RANDOM); // point lookups, no read-ahead
+		if (m_pMap) {
+			munmap(m_pMap, m_nMapSize);
+		}
+		m_pMap = map;
+		m_nMapSize = static_cast<size_t>(st.st_size);
+		m_pHeader = header;
+		const uint8_t* section = static_cast<const uint8_t*>(map) + sizeof(AlprWatchlistHeader);
+		m_pKeys = reinterpret_cast<const uint64_t*>(section);
+		section += keysSize;
+		m_pAttributes = reinterpret_cast<const uint16_t*>(section);
+		section += attributesSize;
+		m_Categories.clear();
+		for (uint32_t i = 0; i < header->numCategories; ++i, section += ALPR_WATCHLIST_CATEGORY_SIZE) {
+			m_Categories.push_back(std::string(reinterpret_cast<const char*>(section), strnlen(reinterpret_cast<const char*>(section), ALPR_WATCHLIST_CATEGORY_SIZE)));
+		}
+		m_pDisp = perfectHash ? reinterpret_cast<const uint32_t*>(section) : nullptr;
+		section += dispSize;
+		m_pSlots = perfectHash ? reinterpret_cast<const uint32_t*>(section) : nullptr;
+		m_Plates.clear();
+		m_Ordinals.clear();
+		ULTALPR_SDK_PRINT_INFO("Watchlist %s: %zu compiled plates%s", path.c_str(), static_cast<size_t>(header->count), perfectHash ? " (perfect hash)" : "");
+		if (storedFilter) {
+			m_Filter.attach(static_cast<const uint8_t*>(map) + filterOffset + alprWatchlistFilterPadding(filterOffset), header->numFilterBlocks);
+		}
+		else { // compiled before the filter was stored: rebuild it, or recompile the list to skip this
+			m_Filter.init(static_cast<size_t>(header->count));
+			for (uint64_t i = 0; i < header->count; ++i) {
+				m_Filter.insert(alprWatchlistFilterHash(m_pKeys[i]));
+			}
+		}
+		logFilter();
+		return true;
+	}
+
+	/*
+	* Looks 'plate' up, 'entry' (when not null) receives its category and priority
+	*/
+	bool find(const std::string& plate, AlprWatchlistEntry* entry = nullptr) const {
+		if (m_Filter.enabled() && !m_Filter.mayContain(alprWatchlistFilterHash(plate))) {
+			if (m_pFilteredCounter) m_pFilteredCounter->add();
+			return false;
+		}
+		const bool found = lookup(plate, entry);
+		if (m_pHitCounter) (found ? m_pHitCounter : m_pFalsePositiveCounter)->add();
+		return found;
+	}
+
+	inline bool contains(const std::string& plate) const {
+		return find(plate);
+	}
+
+	/*
+	* alpr_watchlist_lookups_total{result="filtered"}: rejected by the Bloom filter alone,
+	* {result="hit"}: on the list, {result="false_positive"}: passed the filter but not on the list.
+	* The filter's false positive rate is false_positive / (false_positive + filtered).
+	*/
+	void instrument(AlprMetrics& metrics) {
+		const std::string name = "alpr_watchlist_lookups_total", help = "Watchlist lookups by outcome of the Bloom filter pre-check";
+		m_pFilteredCounter = &metrics.counter(name, "result=\"filtered\"", help);
+		m_pHitCounter = &metrics.counter(name, "result=\"hit\"", help);
+		m_pFalsePositiveCounter = &metrics.counter(name, "result=\"false_positive\"", help);
+	}
+
+	inline const std::string& categoryName(const uint8_t category) const {
+		return m_Categories[category < m_Categories.size() ? category : 0];
+	}
+
+	inline size_t numCategories() const {
+		return m_Categories.size();
+	}
+
+	inline std::string plate(const size_t ordinal) const {
+		return m_pHeader ? alprWatchlistUnpack(m_pKeys[ordinal]) : *m_Ordinals[ordinal];
+	}
+
+	inline size_t size() const {
+		return m_pHeader ? static_cast<size_t>(m_pHeader->count) : m_Plates.size();
+	}
+
+private:
+	AlprWatchlist(const AlprWatchlist&) = delete;
+	AlprWatchlist& operator=(const AlprWatchlist&) = delete;
+
+	void logFilter() const {
+		ULTALPR_SDK_PRINT_INFO("Watchlist Bloom filter: %zu bytes for %zu plates", m_Filter.sizeInBytes(), size());
+	}
+
+	bool lookup(const std::string& plate, AlprWatchlistEntry* entry) const {
+		if (!m_pHeader) {
+			const std::unordered_map<std::string, AlprWatchlistEntry>::const_iterator it = m_Plates.find(plate);
+			if (it == m_Plates.end()) {
+				return false;
+			}
+			if (entry) *entry = it->second;
+			return true;
+		}
+		uint64_t key;
+		if (!alprWatchlistPack(plate, key)) {
+			return false;
+		}
+		size_t index;
+		if (m_pDisp) {
+			const uint32_t d = m_pDisp[alprWatchlistHash(key, 0) % m_pHeader->numBuckets];
+			index = m_pSlots[alprWatchlistHash(key, d) % m_pHeader->tableSize];
+			if (index >= m_pHeader->count || m_pKeys[index] != key) {
+				return false;
+			}
+		}
+		else {
+			const uint64_t* end = m_pKeys + m_pHeader->count;
+			const uint64_t* it = std::lower_bound(m_pKeys, end, key);
+			if (it == end || *it != key) {
+				return false;
+			}
+			index = it - m_pKeys;
+		}
+		if (entry) {
+			entry->category = static_cast<uint8_t>(m_pAttributes[index] >> 8);
+			entry->priority = static_cast<uint8_t>(m_pAttributes[index] & 0xff);
+			entry->ordinal = static_cast<uint32_t>(index);
+		}
+		return true;
+	}
+
+	std::unordered_map<std::string, AlprWatchlistEntry> m_Plates;
+	std::vector<const std::string*> m_Ordinals; // keys of m_Plates, in file order
+	std::vector<std::string> m_Categories;
+	void* m_pMap;
+	size_t m_nMapSize;
+	const AlprWatchlistHeader* m_pHeader;
+	const uint64_t* m_pKeys;
+	const uint16_t* m_pAttributes;
+	const uint32_t* m_pDisp;
+	const uint32_t* m_pSlots;
+	AlprBloomFilter m_Filter;
+	AlprCounter* m_pFilteredCounter;
+	AlprCounter* m_pHitCounter;
+	AlprCounter* m_pFalsePositiveCounter;
+};
+
+#endif /* _ALPR_WATCHLIST_H_ */
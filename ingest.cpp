@@ -0,0 +1,427 @@
+#include <ultimateALPR-SDK-API-PUBLIC.h>
+#include <alpr_utils.h>
+#include <alpr_engine.h>
+#include <alpr_pipeline.h>
+#include <alpr_queue.h>
+#include <alpr_watchlist.h>
+#include <alpr_verify.h>
+#include <alpr_metrics.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+
+/*
+* Watch-folder ingestion, for trigger cameras uploading still images instead of streaming video.
+* Every image written (IN_CLOSE_WRITE) or moved (IN_MOVED_TO) into the folder is decoded, recognized and
+* checked against the watchlist, then moved to <folder>/alert when it raised an alert, <folder>/done otherwise.
+* Images already in the folder at startup are ingested first: a restart picks up where it stopped.
+* Memory stays bounded whatever the burst:
+*	- at most --pending names wait for a decoder, the watcher blocks beyond that and the kernel holds
+*		the events; if its queue overflows (IN_Q_OVERFLOW) the folder is rescanned once there is room
+*	- --decoders threads decode, at most --queue decoded images wait for the engine
+* The engine runs on the main thread (the SDK engine is a singleton).
+*/
+
+/*
+* One decoded image for the engine
+*/
+struct IngestItem {
+	std::string name; // in the watched folder
+	std::shared_ptr<AlprFile> image;
+};
+
+// Set by SIGINT/SIGTERM, the pending images stay in the folder and are ingested at the next start
+static std::atomic<bool> stopRequested(false);
+static void onStopSignal(int)
+{
+	stopRequested = true;
+}
+
+static void printUsage(const std::string& message = "");
+
+static bool isImage(const std::string& name)
+{
+	const size_t dot = name.find_last_of('.');
+	if (name.empty() || name[0] == '.' || dot == std::string::npos) { // hidden: uploads in progress, e.g. rsync temporary files
+		return false;
+	}
+	std::string extension = name.substr(dot + 1);
+	std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+	return (extension == "jpg" || extension == "jpeg" || extension == "png" || extension == "bmp" || extension == "ppm" || extension == "pgm");
+}
+
+// A file that fails to decode within this many seconds of its last change may still be being written
+static const int kIngestGraceSeconds = 10;
+
+/*
+* Names waiting for a decoder or being processed: the events and the rescans may report the same
+* file several times, it's queued once.
+* The files that failed to decode during their grace period stay tracked on the deferred list until the
+* watcher queues them again (takeDue()).
+*/
+class IngestTracker {
+public:
+	bool add(const std::string& name) {
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		return m_Names.insert(name).second;
+	}
+	void remove(const std::string& name) {
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Names.erase(name);
+	}
+	void defer(const std::string& name, const AlprClock::duration& delay) {
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Deferred.push_back(std::make_pair(AlprClock::now() + delay, name));
+	}
+	// Deferred names due for another try, still tracked
+	std::vector<std::string> takeDue() {
+		std::vector<std::string> names;
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		const AlprClock::time_point now = AlprClock::now();
+		for (size_t i = 0; i < m_Deferred.size(); ) {
+			if (m_Deferred[i].first <= now) {
+				names.push_back(m_Deferred[i].second);
+				m_Deferred[i] = m_Deferred.back();
+				m_Deferred.pop_back();
+			}
+			else {
+				++i;
+			}
+		}
+		return names;
+	}
+private:
+	std::mutex m_Mutex;
+	std::unordered_set<std::string> m_Names;
+	std::vector<std::pair<AlprClock::time_point, std::string> > m_Deferred;
+};
+
+/*
+* Moves 'name' from 'folder' into 'targetFolder', 'target' receives its new path. A file of the same name already there
+* (cameras reuse their file names) is kept: link() fails instead of replacing it, and the name gets a "-<n>" suffix.
+*/
+static bool moveTo(const std::string& folder, const std::string& name, const std::string& targetFolder, std::string& target)
+{
+	const std::string source = folder + "/" + name;
+	const size_t dot = name.find_last_of('.');
+	const std::string base = name.substr(0, dot), extension = (dot == std::string::npos) ? "" : name.substr(dot);
+	for (int n = 0; n < 10000; ++n) {
+		target = targetFolder + "/" + (n ? base + "-" + std::to_string(n) + extension : name);
+		if (link(source.c_str(), target.c_str()) == 0) {
+			unlink(source.c_str());
+			return true;
+		}
+		if (errno != EEXIST) {
+			return false;
+		}
+	}
+	return false;
+}
+
+static bool makeDir(const std::string& path)
+{
+	if (mkdir(path.c_str(), 0755) != 0 && errno != EEXIST) {
+		ULTALPR_SDK_PRINT_ERROR("Failed to create %s: %s", path.c_str(), strerror(errno));
+		return false;
+	}
+	return true;
+}
+
+int main(int argc, char** argv) {
+	if (argc < 2 || strncmp(argv[1], "--", 2) == 0) {
+		printUsage("<path-to-folder> required");
+		return -1;
+	}
+	std::map<std::string, std::string > args;
+	if (!alprParseArgs(argc - 1, argv + 1, args)) {
+		printUsage();
+		return -1;
+	}
+	std::string folder = argv[1];
+	while (folder.size() > 1 && folder.back() == '/') {
+		folder.pop_back();
+	}
+	const std::string doneFolder = (args.find("--done") != args.end()) ? args["--done"] : folder + "/done";
+	const std::string alertFolder = (args.find("--alert") != args.end()) ? args["--alert"] : folder + "/alert";
+	const int numDecoders = (args.find("--decoders") != args.end()) ? std::atoi(args["--decoders"].c_str())
+		: std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+	const size_t queueDepth = (args.find("--queue") != args.end()) ? static_cast<size_t>(std::atoi(args["--queue"].c_str())) : 2 * static_cast<size_t>(numDecoders);
+	const size_t pendingDepth = (args.find("--pending") != args.end()) ? static_cast<size_t>(std::atoi(args["--pending"].c_str())) : 1024;
+	const double minConfidence = (args.find("--min_confidence") != args.end()) ? std::atof(args["--min_confidence"].c_str()) : 0.0;
+	if (numDecoders < 1) {
+		printUsage("--decoders must be within [1, inf]");
+		return -1;
+	}
+	if (!makeDir(doneFolder) || !makeDir(alertFolder)) {
+		return -1;
+	}
+
+	// Watchlist
+	AlprWatchlist watchlist;
+	const std::string verifyMode = (args.find("--verify_mode") != args.end()) ? args["--verify_mode"] : "deny";
+	if (verifyMode != "deny" && verifyMode != "allow") {
+		printUsage("--verify_mode must be deny or allow");
+		return -1;
+	}
+	// An empty allowlist alerts on every plate: only the default list of the deny mode may be missing
+	const bool explicitWatchlist = (args.find("--registered") != args.end());
+	const std::string watchlistPath = explicitWatchlist ? args["--registered"] : "../registered.txt";
+	if (!watchlist.load(watchlistPath) && (explicitWatchlist || verifyMode == "allow")) {
+		ULTALPR_SDK_PRINT_ERROR("Failed to load the watchlist %s", watchlistPath.c_str());
+		return -1;
+	}
+	if (!watchlist.size() && verifyMode == "allow") {
+		ULTALPR_SDK_PRINT_ERROR("Empty allowlist %s, every plate would raise an alert", watchlistPath.c_str());
+		return -1;
+	}
+	AlprVerifier verifier(watchlist, verifyMode == "allow");
+	std::ofstream alertsFile;
+	if (args.find("--alerts") != args.end()) {
+		alertsFile.open(args["--alerts"].c_str(), std::ios::app);
+		if (!alertsFile) {
+			ULTALPR_SDK_PRINT_ERROR("Failed to open alerts log: %s", args["--alerts"].c_str());
+			return -1;
+		}
+	}
+	std::ostream& alertsLog = alertsFile.is_open() ? alertsFile : std::cout;
+
+	// Engine
+	const std::string engineName = (args.find("--engine") != args.end()) ? args["--engine"] : alprEngineDefault();
+	const std::string jsonConfig = alprEngineConfig(args, true); // whole photos from trigger cameras: no detection ROI
+	std::unique_ptr<AlprEngine> engine(alprEngineCreate(engineName));
+	if (!engine) {
+		return -1;
+	}
+	ULTALPR_SDK_PRINT_INFO("Starting recognizer (%s)...", engine->name());
+	AlprEngineResult result = engine->init(jsonConfig);
+	if (!result.isOK()) {
+		ULTALPR_SDK_PRINT_ERROR("Failed to initialize the engine: %s", result.phrase.c_str());
+		return -1;
+	}
+	if (!(result = engine->warmUp(ULTALPR_SDK_IMAGE_TYPE_BGR24)).isOK()) {
+		ULTALPR_SDK_PRINT_ERROR("Failed to warm up the engine: %s", result.phrase.c_str());
+		return -1;
+	}
+
+	// Watch before the initial scan, a file written in between is reported twice at worst (see IngestTracker)
+	const int inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (inotifyFd < 0 || inotify_add_watch(inotifyFd, folder.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+		ULTALPR_SDK_PRINT_ERROR("Failed to watch %s: %s", folder.c_str(), strerror(errno));
+		return -1;
+	}
+	struct sigaction stopAction;
+	memset(&stopAction, 0, sizeof(stopAction));
+	stopAction.sa_handler = onStopSignal;
+	sigaction(SIGINT, &stopAction, nullptr);
+	sigaction(SIGTERM, &stopAction, nullptr);
+
+	IngestTracker tracker;
+	AlprBoundedQueue<std::string> pending(pendingDepth);
+	AlprBufferPool imageBuffers(queueDepth + numDecoders);
+	AlprBoundedQueue<IngestItem> decoded(queueDepth);
+
+	// Watcher: blocks on 'pending' when the decoders are behind, the kernel buffers the events meanwhile
+	std::thread watcher([&]() {
+		const auto enqueue = [&](const std::string& name) {
+			return !isImage(name) || !tracker.add(name) || pending.push(name);
+		};
+		bool rescan = true; // initial scan
+		alignas(struct inotify_event) char events[64 * 1024];
+		while (!stopRequested) {
+			if (rescan) {
+				rescan = false;
+				std::vector<std::string> names;
+				if (DIR* dir = opendir(folder.c_str())) {
+					while (struct dirent* entry = readdir(dir)) {
+						names.push_back(entry->d_name);
+					}
+					closedir(dir);
+				}
+				std::sort(names.begin(), names.end());
+				for (const std::string& name : names) {
+					struct stat st;
+					if (stat((folder + "/" + name).c_str(), &st) == 0 && S_ISREG(st.st_mode) && !enqueue(name)) {
+						return;
+					}
+				}
+			}
+			for (const std::string& name : tracker.takeDue()) {
+				if (!pending.push(name)) {
+					return;
+				}
+			}
+			struct pollfd pfd = { inotifyFd, POLLIN, 0 }; // the timeout also bounds the delay of the deferred files
+			if (poll(&pfd, 1, 500) <= 0) {
+				continue;
+			}
+			const ssize_t length = read(inotifyFd, events, sizeof(events));
+			for (ssize_t offset = 0; offset < length; ) {
+				const struct inotify_event* event = reinterpret_cast<const struct inotify_event*>(events + offset);
+				offset += sizeof(struct inotify_event) + event->len;
+				if (event->mask & IN_Q_OVERFLOW) {
+					ULTALPR_SDK_PRINT_WARN("Too many files at once, events lost: rescanning %s", folder.c_str());
+					rescan = true;
+				}
+				else if (event->len && !(event->mask & IN_ISDIR) && !enqueue(event->name)) {
+					return;
+				}
+			}
+		}
+	});
+
+	// Decoders
+	std::vector<std::thread> decoders;
+	for (int d = 0; d < numDecoders; ++d) {
+		decoders.push_back(std::thread([&]() {
+			std::string name;
+			while (pending.pop(name)) {
+				if (stopRequested) { // left in the folder for the next start
+					tracker.remove(name);
+					continue;
+				}
+				IngestItem item;
+				item.name = name;
+				item.image = std::make_shared<AlprFile>();
+				// Read, not mapped: the uploader may still truncate the file and a mapping would then raise SIGBUS
+				if (!alprDecodeFile(folder + "/" + name, *item.image, ULTALPR_SDK_IMAGE_TYPE_BGR24, &imageBuffers, true)) {
+					item.image.reset(); // retried or moved to done/ by the engine thread
+				}
+				if (!decoded.push(std::move(item))) {
+					return;
+				}
+			}
+		}));
+	}
+	std::thread closer([&]() {
+		watcher.join();
+		pending.close();
+		for (std::thread& decoder : decoders) {
+			decoder.join();
+		}
+		decoded.close();
+	});
+
+	ULTALPR_SDK_PRINT_INFO("Watching %s, send SIGTERM or press Ctrl+C to terminate", folder.c_str());
+
+	// Recognition, on this thread. Stops once the decoders are done after a stop request.
+	const AlprClock::time_point start = AlprClock::now();
+	AlprClock::time_point lastProgress = start;
+	size_t numImages = 0, numAlerts = 0, numFailed = 0;
+	uint64_t processMicros = 0;
+	AlprWatchlistEntry entry;
+	std::vector<std::pair<std::string, uint8_t> > hits; // plate and category, logged once the image is moved
+	IngestItem item;
+	while (decoded.pop(item)) {
+		struct stat st;
+		if (!item.image && stat((folder + "/" + item.name).c_str(), &st) != 0) { // gone meanwhile, e.g. renamed by the uploader
+			tracker.remove(item.name);
+			continue;
+		}
+		if (!item.image && time(nullptr) - st.st_mtime < kIngestGraceSeconds) {
+			tracker.defer(item.name, std::chrono::seconds(1)); // maybe still being written, tried again until the grace period is over
+			continue;
+		}
+		numFailed += item.image ? 0 : 1;
+		hits.clear();
+		if (item.image) {
+			const AlprClock::time_point processStart = AlprClock::now();
+			result = engine->process(item.image->type, item.image->uncompressedData, item.image->width, item.image->height);
+			processMicros += alprMicrosSince(processStart);
+			++numImages;
+			if (!result.isOK()) {
+				ULTALPR_SDK_PRINT_WARN("%s: %s", item.name.c_str(), result.phrase.c_str());
+			}
+			else {
+				for (const AlprPlate& plate : alprParsePlates(result.json)) {
+					if (plate.confidence >= minConfidence && verifier.check(plate.text, entry)) {
+						hits.push_back(std::make_pair(plate.text, entry.category));
+					}
+				}
+			}
+			item.image.reset(); // buffer back to the pool before the next decode
+		}
+		const bool alert = !hits.empty();
+		numAlerts += alert ? 1 : 0;
+		std::string target;
+		if (!moveTo(folder, item.name, alert ? alertFolder : doneFolder, target)) {
+			ULTALPR_SDK_PRINT_ERROR("Failed to move %s to %s: %s", item.name.c_str(), alert ? alertFolder.c_str() : doneFolder.c_str(), strerror(errno));
+			target = folder + "/" + item.name;
+		}
+		if (alert) {
+			const uint64_t timestampMillis = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+			for (const std::pair<std::string, uint8_t>& hit : hits) {
+				alertsLog << timestampMillis << "\t" << target << "\t" << hit.first << "\t" << watchlist.categoryName(hit.second) << std::endl;
+			}
+		}
+		tracker.remove(item.name);
+		if (alprMicrosSince(lastProgress) >= 60000000) {
+			lastProgress = AlprClock::now();
+			ULTALPR_SDK_PRINT_INFO("%zu images, %zu alerts, %zu failed to decode, engine %.1lf ms/image, %zu pending, %zu decoded",
+				numImages, numAlerts, numFailed, processMicros / 1000.0 / std::max<size_t>(1, numImages), pending.size(), decoded.size());
+		}
+	}
+	closer.join();
+	close(inotifyFd);
+
+	const double seconds = alprMicrosSince(start) * 1e-6;
+	ULTALPR_SDK_PRINT_INFO("Ingested %zu images in %.1lf seconds, %zu alerts, %zu files failed to decode", numImages, seconds, numAlerts, numFailed);
+
+	ULTALPR_SDK_PRINT_INFO("Ending recognizer...");
+	engine->deInit();
+	return 0;
+}
+
+static void printUsage(const std::string& message /*= ""*/)
+{
+	if (!message.empty()) {
+		ULTALPR_SDK_PRINT_ERROR("%s", message.c_str());
+	}
+	ULTALPR_SDK_PRINT_INFO(
+		"\n********************************************************************************\n"
+		"ingest <path-to-folder>\n"
+		"\t[--registered <path-to-watchlist>] \n"
+		"\t[--verify_mode <deny / allow>] \n"
+		"\t[--alerts <path-to-alerts-log>] \n"
+		"\t[--done <path-to-folder>] [--alert <path-to-folder>] \n"
+		"\t[--min_confidence <percent>] \n"
+		"\t[--decoders <threads>] \n"
+		"\t[--queue <images>] \n"
+		"\t[--pending <files>] \n"
+		"\t[--assets <path-to-assets-folder>] \n"
+		"\t[--engine <sdk / mock>] \n"
+		"\t[--mock_results <path-to-json-lines>] \n"
+		"\t[--mock_latency_ms <millis>] \n"
+		"\n"
+		"Options surrounded with [] are optional.\n"
+		"\n"
+		"<path-to-folder>: Folder the cameras upload to. Images (jpg, jpeg, png, bmp, ppm, pgm) already there and written later are ingested. Hidden files are ignored until renamed.\n\n"
+		"--registered: Watchlist, text or compiled. Must load when given, and must not be empty with --verify_mode allow. Default: ../registered.txt.\n\n"
+		"--verify_mode: 'deny' alerts on registered plates, 'allow' on plates not registered. Default: deny.\n\n"
+		"--alerts: Log the alerts are appended to, one line per plate: time (ms), image path, plate and category. Default: stdout.\n\n"
+		"--done: Where the images without alert are moved to, and those that failed to decode (retried every second while modified less than 10 seconds ago, maybe still being written). An image of the same name already there is kept, the new one gets a -<n> suffix (also in --alert). Default: <path-to-folder>/done.\n\n"
+		"--alert: Where the images with an alert are moved to. Default: <path-to-folder>/alert.\n\n"
+		"--min_confidence: Minimum recognition confidence for a plate to be checked. Default: 0.\n\n"
+		"--decoders: Number of decoder threads. Default: number of cores.\n\n"
+		"--queue: Decoded images waiting for the engine, at most. Default: 2 x --decoders.\n\n"
+		"--pending: File names waiting for a decoder, at most. Default: 1024.\n\n"
+		"--assets: Path to the assets folder. Default: ../assets.\n\n"
+		"--engine: Recognition backend, see main. Default: sdk when built with the SDK, mock otherwise.\n\n"
+		"********************************************************************************\n"
+	);
+}
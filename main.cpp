@@ -1,47 +1,45 @@
 #include <ultimateALPR-SDK-API-PUBLIC.h>
 #include <alpr_utils.h>
-#include <opencv2/opencv.hpp>
+#include <alpr_metrics.h>
+#include <alpr_http.h>
+#include <alpr_engine.h>
+#include <alpr_pipeline.h>
+#include <alpr_record.h>
+#include <alpr_watchlist.h>
+#include <alpr_actions.h>
+#include <alpr_verify.h>
+#include <alpr_preview.h>
+#include <alpr_queue.h>
+#include <alpr_capture.h>
+#include <alpr_v4l2.h>
+#include <alpr_quality.h>
+#include <alpr_trt.h>
 #include <opencv2/core.hpp>
+#include <opencv2/imgproc.hpp>
 #include <opencv2/videoio.hpp>
+#if !ALPR_HEADLESS
 #include <opencv2/highgui.hpp>
+#endif /* !ALPR_HEADLESS */
 #include <json.hpp> // nlohmann/json
 #include <iostream>
 #include <fstream>
 #include <vector>
 #include <algorithm> // std::replace
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
 
 #include <fcntl.h>
+#include <signal.h>
 #include <stdio.h>
+#include <stdlib.h> // mkdtemp
 #include <unistd.h>
 #include <sys/stat.h>
+#include <sys/wait.h>
+#include <errno.h>
 using namespace ultimateAlprSdk;
-// Configuration for ANPR deep learning engine
-static const char* __jsonConfig =
-"{"
-"\"debug_level\": \"fatal\","
-"\"debug_write_input_image_enabled\": false,"
-"\"debug_internal_data_path\": \".\","
-""
-"\"num_threads\": -1,"
-"\"gpgpu_enabled\": true,"
-""
-"\"klass_vcr_gamma\": 1.5,"
-""
-"\"detect_roi\": [600, 1200, 0, 600],"
-"\"detect_minscore\": 0.1,"
-""
-"\"pyramidal_search_enabled\": false,"
-"\"pyramidal_search_sensitivity\": 0.28,"
-"\"pyramidal_search_minscore\": 0.3,"
-"\"pyramidal_search_min_image_size_inpixels\": 800,"
-""
-"\"recogn_minscore\": 0.3,"
-"\"recogn_score_type\": \"min\","
-""
-"\"assets_folder\": \"../assets\","
-"\"license_token_data\": \"ANI6+wXQBUVDUFFVdzBBR1VQRkMuBApERW4nS1FTRkgvKTEAGTwQeEtZREJUdkdVV3tGCWl3akZOXFg4G3Q2Ymk7cUFYWygGCBQqDgZVSUUzPW5LaUUxRlUpImJcRkFkMRscJyQ6RlhxRTxODAtKNTE3MGRlRDFdVGZqVDc1fScXNH5IX1AlCzkjKRdRNUVbXGYMLz0/JigQBg5gVmNiW3oxeUtxCFU6I1J6WDUyXiEyGhlSQz0/QxgpJzIqXyxXV35eaDBRJ059aHAVPhk5P2N6LzoeVls=\""
-"}";
-
 // Sound
 char MPLAYER_CTRL[] = "/tmp/mplayer-control";
 int startMPlayerInBackground()
@@ -66,8 +64,215 @@ void send(char* cmd)
     close(fdes);
 }
 
+// Never blocks: does nothing when mplayer is not reading the control fifo
+void stopMPlayer()
+{
+	int fdes = open(MPLAYER_CTRL, O_WRONLY | O_NONBLOCK);
+	if (fdes >= 0) {
+		ssize_t dummy = write(fdes, "quit\n", 5);
+		close(fdes);
+	}
+}
+
+// Set by SIGINT/SIGTERM, the main loop stops at the end of the current frame
+static std::atomic<bool> stopRequested(false);
+static void onStopSignal(int)
+{
+	stopRequested = true;
+}
+
+static void printUsage(const std::string& message = "");
+static size_t decide(AlprPlateVoter& voter, AlprVerifier& verifier, AlprActionTable& actions, std::ostream* alertsLog, const uint32_t frame, const uint64_t timestampMicros, const std::string& json);
+static int replay(const std::string& path, AlprPlateVoter& voter, AlprVerifier& verifier, AlprActionTable& actions, std::ostream* alertsLog);
+static int batch(const std::string& videoPath, const AlprCaptureOptions& capture, AlprEngine& engine, const std::string& jsonConfig, const size_t queueDepth, const int numSegments,
+	AlprPlateVoter& voter, AlprVerifier& verifier, AlprActionTable& actions, std::ostream* alertsLog, AlprRecordWriter& recorder);
 
 int main(int argc, char** argv) {
+	AlprStartupProfile startup;
+	// Options follow the video path and the scale factor, which are not needed by --replay
+	const int numPositionals = (argc >= 3 && strncmp(argv[1], "--", 2) != 0) ? 2 : 0;
+	std::map<std::string, std::string > args;
+	if (!alprParseArgs(argc - numPositionals, argv + numPositionals, args)) {
+		printUsage();
+		return -1;
+	}
+	if (!numPositionals && args.find("--replay") == args.end()) {
+		printUsage("<path-to-video> and <display-scale-factor> required");
+		return -1;
+	}
+
+	// Decision logic
+	const int numRepeat = (args.find("--num_repeat") != args.end()) ? std::atoi(args["--num_repeat"].c_str()) : 5;
+	if (numRepeat < 1) {
+		printUsage("--num_repeat must be within [1, inf]");
+		return -1;
+	}
+	AlprPlateVoter voter(numRepeat);
+	AlprWatchlist watchlist;
+	const std::string verifyMode = (args.find("--verify_mode") != args.end()) ? args["--verify_mode"] : "deny";
+	if (verifyMode != "deny" && verifyMode != "allow") {
+		printUsage("--verify_mode must be deny or allow");
+		return -1;
+	}
+	// An empty allowlist alerts on every plate: only the default list of the deny mode may be missing
+	const bool explicitWatchlist = (args.find("--registered") != args.end());
+	const std::string watchlistPath = explicitWatchlist ? args["--registered"] : "../registered.txt";
+	if (!watchlist.load(watchlistPath) && (explicitWatchlist || verifyMode == "allow")) {
+		ULTALPR_SDK_PRINT_ERROR("Failed to load the watchlist %s", watchlistPath.c_str());
+		return -1;
+	}
+	if (!watchlist.size() && verifyMode == "allow") {
+		ULTALPR_SDK_PRINT_ERROR("Empty allowlist %s, every plate would raise an alert", watchlistPath.c_str());
+		return -1;
+	}
+	AlprActionTable actions;
+	if (args.find("--actions") != args.end() && !actions.load(args["--actions"])) {
+		return -1;
+	}
+	actions.bind(watchlist);
+	AlprVerifier verifier(watchlist, verifyMode == "allow");
+	if (args.find("--coverage_report") != args.end()) {
+		verifier.setReport(args["--coverage_report"], (args.find("--coverage_interval") != args.end()) ? std::atof(args["--coverage_interval"].c_str()) : 3600.0);
+	}
+	std::ofstream alertsFile;
+	if (args.find("--alerts") != args.end()) {
+		alertsFile.open(args["--alerts"].c_str());
+		if (!alertsFile) {
+			ULTALPR_SDK_PRINT_ERROR("Failed to create alerts log: %s", args["--alerts"].c_str());
+			return -1;
+		}
+	}
+	std::ostream* alertsLog = alertsFile.is_open() ? &alertsFile : nullptr;
+	if (args.find("--replay") != args.end()) {
+		return replay(args["--replay"], voter, verifier, actions, alertsLog);
+	}
+
+	// Instrumentation
+	AlprMetrics& metrics = AlprMetrics::instance();
+	const std::string stageFamily = "alpr_stage_latency_seconds", stageHelp = "Time spent in each stage of the main loop";
+	AlprHistogram& captureHist = metrics.histogram(stageFamily, "stage=\"capture\"", stageHelp);
+	AlprHistogram& processHist = metrics.histogram(stageFamily, "stage=\"process\"", stageHelp);
+	AlprHistogram& parseHist = metrics.histogram(stageFamily, "stage=\"parse\"", stageHelp);
+	AlprHistogram& drawHist = metrics.histogram(stageFamily, "stage=\"draw\"", stageHelp);
+	AlprHistogram& writeHist = metrics.histogram(stageFamily, "stage=\"write\"", stageHelp);
+	AlprHistogram& displayHist = metrics.histogram(stageFamily, "stage=\"display\"", stageHelp);
+	AlprHistogram& frameHist = metrics.histogram("alpr_frame_latency_seconds", "", "Time to handle one frame, all stages included");
+	AlprHistogram& alertHist = metrics.histogram("alpr_capture_to_alert_seconds", "", "Time from frame capture to the alert being raised");
+	AlprHistogram& ageHist = metrics.histogram("alpr_frame_age_seconds", "", "Age of the frame when it is handed to the engine");
+	AlprCounter& framesCounter = metrics.counter("alpr_frames_total", "", "Frames grabbed");
+	AlprCounter& staleCounter = metrics.counter("alpr_frames_dropped_total", "reason=\"stale\"", "Frames dropped before inference");
+	AlprCounter& platesCounter = metrics.counter("alpr_plates_total", "", "Plates with a valid length");
+	AlprCounter& alertsCounter = metrics.counter("alpr_alerts_total", "", "Registered plates confirmed");
+	watchlist.instrument(metrics);
+	AlprCounter& cooldownCounter = metrics.counter("alpr_alerts_suppressed_total", "reason=\"cooldown\"", "Confirmed hits not alerted again within the cooldown of their category");
+	AlprHttpServer metricsServer;
+	if (args.find("--metrics_port") != args.end()) {
+		const bool started = metricsServer.start(static_cast<unsigned short>(std::atoi(args["--metrics_port"].c_str())),
+			[&metrics](const std::string& path, AlprHttpResponse& response) {
+				if (path != "/metrics") {
+					return false;
+				}
+				response.contentType = "text/plain; version=0.0.4";
+				response.body = metrics.prometheus();
+				return true;
+			});
+		if (!started) {
+			return -1;
+		}
+	}
+	const uint64_t maxAgeMicros = (args.find("--max_age_ms") != args.end()) ? static_cast<uint64_t>(std::atof(args["--max_age_ms"].c_str()) * 1000.0) : 0;
+	const double statsInterval = (args.find("--stats_interval") != args.end()) ? std::atof(args["--stats_interval"].c_str()) : 0.0;
+	AlprClock::time_point lastStats = AlprClock::now();
+
+	// Headless: no window and no keyboard, stop with SIGINT/SIGTERM
+#if ALPR_HEADLESS
+	const bool headless = true;
+#else
+	const bool headless = (args.find("--headless") != args.end()) && (args["--headless"].compare("true") == 0);
+#endif /* ALPR_HEADLESS */
+	struct sigaction stopAction;
+	memset(&stopAction, 0, sizeof(stopAction));
+	stopAction.sa_handler = onStopSignal;
+	sigaction(SIGINT, &stopAction, nullptr);
+	sigaction(SIGTERM, &stopAction, nullptr);
+	const double previewFps = (args.find("--preview_fps") != args.end()) ? std::atof(args["--preview_fps"].c_str()) : 2.0;
+	if (!(previewFps > 0.0)) {
+		printUsage("--preview_fps must be > 0");
+		return -1;
+	}
+	AlprMjpegPreview preview(previewFps);
+	AlprHttpServer previewServer;
+	if (args.find("--preview_port") != args.end()) {
+		const bool started = previewServer.start(static_cast<unsigned short>(std::atoi(args["--preview_port"].c_str())),
+			[&preview](const std::string& path, AlprHttpResponse& response) {
+				return preview.handle(path, response);
+			});
+		if (!started) {
+			return -1;
+		}
+	}
+
+	AlprEngineResult result;
+	std::string charset = "latin";
+	std::string jsonConfig = alprEngineConfig(args, false);
+	const std::string engineName = (args.find("--engine") != args.end()) ? args["--engine"] : alprEngineDefault();
+	const std::string backend = (args.find("--backend") != args.end()) ? args["--backend"] : "auto";
+	jsonConfig = alprEngineBackendConfig(jsonConfig, backend, (args.find("--openvino_device") != args.end()) ? args["--openvino_device"] : "CPU");
+	if (jsonConfig.empty()) {
+		printUsage("--backend must be auto, cpu, openvino or tensorrt");
+		return -1;
+	}
+	const std::string assetsFolder = nlohmann::json::parse(jsonConfig).value("assets_folder", std::string("."));
+	if (engineName == "sdk" && !alprEngineBackendAvailable(backend, assetsFolder)) { // the SDK would fail or fall back in init()
+		const std::string needs = (backend == "openvino") ? "an x86 CPU and " + assetsFolder + "/models.openvino" : "a Jetson and " + assetsFolder + "/models.tensorrt";
+		ULTALPR_SDK_PRINT_ERROR("Backend '%s' not available on this host, it needs %s", backend.c_str(), needs.c_str());
+		return -1;
+	}
+
+	std::unique_ptr<AlprEngine> engine(alprEngineCreate(engineName));
+	if (!engine) {
+		printUsage("--engine must be sdk or mock");
+		return -1;
+	}
+	// Jetson: stale TensorRT plans are rebuilt by init(), for minutes, or silently not used.
+	// Only checked when the plans are used: --backend tensorrt, or auto on a Jetson with the TensorRT models
+	const bool usesTrtPlans = engineName == "sdk" && (backend == "tensorrt"
+		|| (backend == "auto" && alprEngineBackendAvailable("tensorrt", assetsFolder)));
+	const std::string trtPlugin = (args.find("--trt_plugin") != args.end()) ? args["--trt_plugin"] : "../lib/libultimatePluginTensorRT.so";
+	const std::string trtCheck = (args.find("--trt_check") != args.end()) ? args["--trt_check"] : "warn";
+	if (trtCheck != "strict" && trtCheck != "warn" && trtCheck != "off") {
+		printUsage("--trt_check must be strict, warn or off");
+		return -1;
+	}
+	if (trtCheck != "off" && usesTrtPlans) {
+		std::vector<std::string> problems;
+		if (!alprTrtCheck(assetsFolder, trtPlugin, problems)) {
+			for (const std::string& problem : problems) {
+				ULTALPR_SDK_PRINT_WARN("TensorRT plans: %s", problem.c_str());
+			}
+			ULTALPR_SDK_PRINT_WARN("**** TensorRT plans in %s/models.tensorrt are stale, run \"make trt_plans\" (or trt_prepare) before starting ****", assetsFolder.c_str());
+			if (trtCheck == "strict") {
+				return -1;
+			}
+		}
+	}
+	AlprRecordWriter recorder;
+	if (args.find("--record") != args.end() && !recorder.open(args["--record"])) {
+		return -1;
+	}
+
+	const AlprCaptureOptions captureOptions = alprCaptureParseArgs(args);
+
+	// Offline: decode ahead, keep the engine busy and skip everything that runs at live pace
+	if (args.find("--batch") != args.end() && args["--batch"].compare("true") == 0) {
+		const size_t queueDepth = (args.find("--batch_queue") != args.end()) ? std::atoi(args["--batch_queue"].c_str()) : 16;
+		int numSegments = (args.find("--segments") != args.end()) ? std::atoi(args["--segments"].c_str()) : 1;
+		if (numSegments <= 0) {
+			numSegments = std::max(1u, std::thread::hardware_concurrency());
+		}
+		return batch(argv[1], captureOptions, *engine, jsonConfig, queueDepth, numSegments, voter, verifier, actions, alertsLog, recorder);
+	}
+
 	// sound player init
 	unlink(MPLAYER_CTRL);
     int res = mknod(MPLAYER_CTRL, S_IFIFO|0777, 0);
@@ -77,105 +282,281 @@ int main(int argc, char** argv) {
 		exit(1);
     }
 
-	UltAlprSdkResult result;
-	std::string charset = "latin";
-	std::string jsonConfig = __jsonConfig;
-	
-	ULTALPR_SDK_PRINT_INFO("Starting recognizer...");
-	result = UltAlprSdkEngine::init(jsonConfig.c_str());
+	// Adaptive quality: the controller steps between tiers to hold --target_fps
+	const double targetFps = (args.find("--target_fps") != args.end()) ? std::atof(args["--target_fps"].c_str()) : 0.0;
+	std::vector<AlprQualityTier> qualityTiers = alprQualityDefaultTiers();
+	if (args.find("--quality_tiers") != args.end() && !alprQualityLoadTiers(args["--quality_tiers"], qualityTiers)) {
+		return -1;
+	}
+	AlprQualityController quality(qualityTiers, targetFps);
+	AlprCounter& qualityCounter = metrics.counter("alpr_quality_changes_total", "", "Quality tier changes");
+	const bool v4l2Native = (captureOptions.backend == "v4l2_mmap");
+	const auto qualityTier = [&quality, v4l2Native]() {
+		AlprQualityTier tier = quality.tier();
+		if (v4l2Native) {
+			tier.scale = 1.0; // the driver's buffers go to the engine as they are
+			tier.roi = 1.0;
+		}
+		return tier;
+	};
+	// The crop and the downscale are done here, before process(): changing the tier never re-initializes the engine.
+	// The crop follows the size of the first frame.
+	const bool qualityCrops = quality.enabled() && !v4l2Native;
+	const std::vector<double> detectRoi = nlohmann::json::parse(jsonConfig).value("detect_roi", std::vector<double>());
+	AlprQualityTier tier = qualityTier();
+	cv::Size frameSize;
+	cv::Rect crop;
+	const std::string engineConfig = qualityCrops ? alprQualityConfig(jsonConfig) : jsonConfig;
 
+	// Startup: the engine loads its models in init() and lazily on the first frames, warm it up with the pixel format
+	// of the frames before the capture starts. With --overlap_startup the capture is opened (and its decoder primed
+	// with the first frame) on a separate thread meanwhile.
+	const bool overlapStartup = (args.find("--overlap_startup") != args.end()) && (args["--overlap_startup"].compare("true") == 0);
+	const ULTALPR_SDK_IMAGE_TYPE warmUpType = !v4l2Native ? ULTALPR_SDK_IMAGE_TYPE_BGR24
+		: (captureOptions.fourcc == "NV12" ? ULTALPR_SDK_IMAGE_TYPE_NV12 : ULTALPR_SDK_IMAGE_TYPE_Y);
+	cv::VideoCapture cap;
+	AlprV4l2Source v4l2;
+	cv::Mat primedFrame;
+	AlprClock::time_point primedAt;
+	const auto openCapture = [&]() {
+		if (v4l2Native) {
+			if (!v4l2.open(argv[1], captureOptions.width > 0 ? captureOptions.width : 1280, captureOptions.height > 0 ? captureOptions.height : 720,
+				captureOptions.fourcc.empty() ? "YUYV" : captureOptions.fourcc, captureOptions.buffers > 0 ? captureOptions.buffers : 4, captureOptions.fps)) {
+				return false;
+			}
+		}
+		else if (!alprCaptureOpen(cap, argv[1], captureOptions)) {
+			return false;
+		}
+		startup.mark("capture_open");
+		if (overlapStartup && !v4l2Native && cap.read(primedFrame)) {
+			primedAt = AlprClock::now();
+			startup.mark("decoder_ready");
+		}
+		return true;
+	};
+	bool captureOpened = false;
+	std::thread captureOpener;
+	if (overlapStartup) {
+		captureOpener = std::thread([&]() { captureOpened = openCapture(); });
+	}
 
-    cv::VideoCapture cap(argv[1]);
-    if (!cap.isOpened()) {
-        std::cerr << "ERROR! Unable to open.\n";
-        return -1;
-    }
+	ULTALPR_SDK_PRINT_INFO("Starting recognizer (%s)...", engine->name());
+	result = engine->init(engineConfig);
+	if (result.isOK()) {
+		startup.mark("init");
+		result = engine->warmUp(warmUpType);
+	}
+	if (captureOpener.joinable()) {
+		captureOpener.join();
+	}
+	if (!result.isOK()) {
+		ULTALPR_SDK_PRINT_ERROR("Failed to initialize the engine: %s", result.phrase.c_str());
+		return -1;
+	}
+	startup.mark("warm_up");
+
+	if (!overlapStartup) {
+		captureOpened = openCapture();
+	}
+	if (!captureOpened) {
+		std::cerr << "ERROR! Unable to open.\n";
+		return -1;
+	}
+	// With --max_age_ms, frames are read ahead on a thread that keeps the newest one: the frames the loop is too
+	// slow for are shed there and the age of the one it takes grows with the time it waited
+	AlprFrameGrabber grabber;
+	if (maxAgeMicros && !v4l2Native) {
+		grabber.start(cap);
+	}
     std::cout << "Start grabbing" << std::endl
-        << "Press any key to terminate" << std::endl;
-	cv::VideoWriter video("out.mp4", cv::VideoWriter::fourcc('M', 'J', 'P', 'G'), 30, cv::Size(1280, 720));
-
-	int numRepeat = 5, refresh = 10000, residual = 200;
-	int numIter = 0;
-	std::vector<std::string> allPrevDigits;
-
-	std::vector<std::string> registeredDigits;
-	std::fstream registered;
-	registered.open("../registered.txt", std::ios::in);
-	std::string buff;
-	while(registered >> buff)
-		registeredDigits.push_back(buff);
-	registered.close();
+        << (headless ? "Send SIGTERM or press Ctrl+C to terminate" : "Press any key to terminate") << std::endl;
+	cv::VideoWriter video; // opened with the size of the first frame written, OpenCV drops the frames of any other size
+
+	uint32_t numFrames = 0;
+	AlprClock::time_point firstCapture;
+
 	double alpha = 0;
+	cv::Scalar overlayColour(0, 0, 255);
 	double scale = std::atof(argv[2]);
 
     while (true) {
    		cv::Mat frame;
-		if (numIter++ > refresh) {
-			numIter = 0;
-			allPrevDigits = std::vector<std::string>(allPrevDigits.end()-residual, allPrevDigits.end());
+		voter.nextFrame();
+
+		const AlprClock::time_point frameStart = AlprClock::now();
+		AlprClock::time_point readAt;
+		AlprV4l2Frame raw;
+		if (v4l2.isOpen()) {
+			while (!v4l2.dequeue(raw) && !v4l2.ended() && !stopRequested) {
+				// the timeout only gives a chance to see the stop request
+			}
+			if (raw.index < 0) {
+				if (!stopRequested) {
+					std::cerr << "ERROR! no frame dequeued\n";
+				}
+				break;
+			}
+		}
+		else if (!primedFrame.empty()) {
+			frame = primedFrame; // read while the engine was loading, its age tells how long it waited
+			primedFrame = cv::Mat();
+			readAt = primedAt;
+		}
+		else if (grabber.running()) {
+			if (!grabber.next(frame, readAt)) {
+				std::cerr << "ERROR! blank frame grabbed\n";
+				break;
+			}
+			staleCounter.add(grabber.takeOverwritten());
+		}
+		else {
+	        cap.read(frame);
+	        if (frame.empty()) {
+	            std::cerr << "ERROR! blank frame grabbed\n";
+	            break;
+	        }
+		}
+		const AlprClock::time_point captured = AlprClock::now();
+		if (!numFrames++) {
+			firstCapture = captured;
+			startup.mark("first_frame");
+		}
+		captureHist.record(alprMicrosSince(frameStart, captured));
+		framesCounter.add();
+
+		// Capture time: the driver's timestamp (monotonic clock) when there's one, otherwise when the frame was read,
+		// by the grabber thread with --max_age_ms. Without it, frames are read when needed and look fresh.
+		AlprClock::time_point captureTime = (readAt != AlprClock::time_point() && readAt <= captured) ? readAt : captured;
+		if (v4l2.isOpen() && raw.timestampMicros) {
+			const AlprClock::time_point stamped = AlprClock::time_point(std::chrono::microseconds(raw.timestampMicros));
+			if (stamped <= captured) {
+				captureTime = stamped;
+			}
+		}
+		const uint64_t ageMicros = alprMicrosSince(captureTime, captured);
+		ageHist.record(ageMicros);
+		if (maxAgeMicros && ageMicros > maxAgeMicros) {
+			// Past its deadline: processing it would only delay the fresher ones queued behind
+			staleCounter.add();
+			recorder.write(alprMicrosSince(firstCapture, captured), std::string());
+			if (v4l2.isOpen()) {
+				v4l2.requeue(raw);
+			}
+			if (stopRequested) {
+				break;
+			}
+			continue;
 		}
 
-        cap.read(frame);
-        if (frame.empty()) {
-            std::cerr << "ERROR! blank frame grabbed\n";
-            break;
-        }
 		//recognize
-		result = UltAlprSdkEngine::process(
-			ULTALPR_SDK_IMAGE_TYPE_BGR24,
-			frame.data,
-			1280,
-			720
-		);
+		bool processed = true;
+		if (quality.enabled() && (numFrames - 1) % tier.stride != 0) {
+			result = AlprEngineResult(); // skipped by the quality tier
+			processed = false;
+		}
+		else if (v4l2.isOpen()) {
+			result = v4l2.process(*engine, raw); // straight from the driver's buffer
+		}
+		else {
+			if (qualityCrops && frame.size() != frameSize) {
+				frameSize = frame.size();
+				crop = alprQualityCrop(frameSize, detectRoi, tier.roi);
+			}
+			cv::Mat input = (qualityCrops && crop.size() != frameSize) ? frame(crop) : frame;
+			if (tier.scale < 1.0) {
+				cv::resize(input, input, cv::Size(), tier.scale, tier.scale, cv::INTER_AREA);
+			}
+			result = engine->process(
+				ULTALPR_SDK_IMAGE_TYPE_BGR24,
+				input.data,
+				input.cols,
+				input.rows,
+				input.step / input.elemSize()
+			);
+		}
+		AlprClock::time_point stageStart = AlprClock::now();
+		processHist.record(alprMicrosSince(captured, stageStart));
+		if (processed && startup.processed(alprMicrosSince(captured, stageStart))) {
+			ULTALPR_SDK_PRINT_INFO("Startup: %s", startup.summary().c_str());
+		}
+		uint64_t drawMicros = 0;
+		if (v4l2.isOpen()) {
+			// The result is back: convert for the overlay and give the buffer back to the driver
+			AlprV4l2Source::toBgr(raw, frame);
+			v4l2.requeue(raw);
+			drawMicros = alprMicrosSince(stageStart);
+		}
+		const uint64_t timestampMicros = alprMicrosSince(firstCapture, captured);
+		recorder.write(timestampMicros, result.numPlates ? result.json : std::string());
 
 		bool warning = false;
+		const AlprAlertAction* alertAction = nullptr; // of the highest priority hit of the frame
+		int alertPriority = -1;
 		// Print latest result
-		if (result.numPlates()) {
-			const std::string& json_ = result.json();
-			if (!json_.empty()) {
-				nlohmann::json parsed = nlohmann::json::parse(json_);
-				// std::cout << parsed << std::endl;
-				for (int i = 0; i < result.numPlates(); i++) {
-					std::string digits = parsed.at("plates").at(i).at("text").get<std::string>();
-					const std::vector<double> loc = parsed.at("plates").at(i).at("warpedBox").get<std::vector<double> >();
-					if (digits.length() == 6 || digits.length() == 7) {
-						std::replace(digits.begin(), digits.end(), 'I', '1'); // Taiwanese standard
-						std::replace(digits.begin(), digits.end(), 'O', '0'); // Taiwanese standard
-						std::replace(digits.begin(), digits.end(), 'W', 'M'); // ambiguous and M is far more than W
-	
-						allPrevDigits.push_back(digits);
-						if (std::count(allPrevDigits.begin(), allPrevDigits.end(), digits) == numRepeat) {
-							if (std::count(registeredDigits.begin(), registeredDigits.end(), digits) != 0)
-								warning = true;
-						}
-						cv::putText(
-							frame,
-							digits,
-							cv::Point(loc[0]-20, loc[1]-20),
-							cv::FONT_HERSHEY_DUPLEX,
-							1.0,
-							cv::Scalar(255, 255, 255),
-							2
-						);
-						cv::rectangle(
-							frame,
-							cv::Point(loc[0], loc[1]),
-							cv::Point(loc[4], loc[5]),
-							cv::Scalar(0, 255, 0),
-							2
-						);
-						
+		if (result.numPlates) {
+			for (const AlprPlate& plate : alprParsePlates(result.json)) {
+				const std::string& digits = plate.text;
+				std::vector<double> loc = plate.warpedBox;
+				for (size_t i = 0; i + 1 < loc.size(); i += 2) {
+					// back to the full frame when the quality tier crops or downscales
+					loc[i] = loc[i] / tier.scale + crop.x;
+					loc[i + 1] = loc[i + 1] / tier.scale + crop.y;
+				}
+				platesCounter.add();
+				AlprWatchlistEntry entry;
+				const bool hit = voter.vote(digits) && verifier.check(digits, entry);
+				const AlprAlertAction& action = actions.action(entry.category);
+				if (hit && !actions.admit(digits, action, timestampMicros)) {
+					cooldownCounter.add();
+				}
+				else if (hit) {
+					warning = true;
+					if (!action.logOnly && entry.priority > alertPriority) {
+						alertAction = &action;
+						alertPriority = entry.priority;
+					}
+					if (alertsLog) {
+						// 4th column: capture to decision latency, millis
+						*alertsLog << (numFrames - 1) << "\t" << timestampMicros / 1000 << "\t" << digits << "\t" << alprMicrosSince(captureTime) / 1000.0 << "\n";
 					}
 				}
-
+				const AlprClock::time_point drawStart = AlprClock::now();
+				cv::putText(
+					frame,
+					digits,
+					cv::Point(loc[0]-20, loc[1]-20),
+					cv::FONT_HERSHEY_DUPLEX,
+					1.0,
+					cv::Scalar(255, 255, 255),
+					2
+				);
+				cv::rectangle(
+					frame,
+					cv::Point(loc[0], loc[1]),
+					cv::Point(loc[4], loc[5]),
+					cv::Scalar(0, 255, 0),
+					2
+				);
+				drawMicros += alprMicrosSince(drawStart);
 			}
 		}
 
+		parseHist.record(alprMicrosSince(stageStart) - drawMicros);
+
 		if (warning) {
-			char* soundPath = (char*)"loadfile ../sound/sound.mp3\n";
-			send(soundPath);
-			alpha = 0.8;
+			if (alertAction) {
+				if (!alertAction->sound.empty()) {
+					std::string soundCommand = "loadfile " + alertAction->sound + "\n";
+					send(&soundCommand[0]);
+				}
+				overlayColour = alertAction->colour;
+				alpha = 0.8;
+			}
+			alertHist.recordSince(captureTime);
+			alertsCounter.add();
 		}
+		stageStart = AlprClock::now();
 		alpha-=0.025;
 		if (alpha < 0)
 			alpha = 0;
@@ -185,8 +566,8 @@ int main(int argc, char** argv) {
 			cv::rectangle(
 				overlay,
 				cv::Point(0, 0),
-				cv::Point(1280, 720),
-				cv::Scalar(0, 0, 255),
+				cv::Point(overlay.cols, overlay.rows),
+				overlayColour,
 				-1
 			);
 			cv::addWeighted(overlay, alpha, frame, 1- alpha, 0, frame);
@@ -199,16 +580,487 @@ int main(int argc, char** argv) {
 		);
 		
 
+		drawHist.record(drawMicros + alprMicrosSince(stageStart));
+
+		if (preview.due()) {
+			preview.publish(frame);
+		}
+
         // show live and wait for a key with timeout long enough to show images
-        cv::imshow("Live", frame);
+		int key = -1;
+		stageStart = AlprClock::now();
+#if !ALPR_HEADLESS
+		if (!headless) {
+			cv::imshow("Live", frame);
+		}
+#endif /* !ALPR_HEADLESS */
+		const AlprClock::time_point displayed = AlprClock::now();
+		if (!video.isOpened()) {
+			video.open("out.mp4", cv::VideoWriter::fourcc('M', 'J', 'P', 'G'), 30, frame.size());
+		}
 		video.write(frame);
-        if (cv::waitKey(5) >= 0)
+		const AlprClock::time_point written = AlprClock::now();
+		writeHist.record(alprMicrosSince(displayed, written));
+#if !ALPR_HEADLESS
+		if (!headless) {
+			key = cv::waitKey(5);
+		}
+#endif /* !ALPR_HEADLESS */
+		if (!headless) {
+			displayHist.record(alprMicrosSince(stageStart, displayed) + alprMicrosSince(written));
+		}
+		frameHist.recordSince(frameStart);
+
+		if (quality.update(alprMicrosSince(captured), v4l2.isOpen() ? v4l2.pendingFrames() : 0)) {
+			qualityCounter.add();
+			tier = qualityTier();
+			if (qualityCrops && frameSize.area()) {
+				crop = alprQualityCrop(frameSize, detectRoi, tier.roi);
+			}
+		}
+
+		if (statsInterval > 0 && alprMicrosSince(lastStats) >= statsInterval * 1e6) {
+			lastStats = AlprClock::now();
+			std::cerr << "[stats] " << metrics.statsLine() << std::endl;
+		}
+		verifier.tick();
+        if (key >= 0 || stopRequested)
             break;
     }
+	// Drain: everything below flushes what's still buffered
+	if (stopRequested) {
+		ULTALPR_SDK_PRINT_INFO("Stop requested, draining...");
+	}
+	if (!startup.steady()) {
+		ULTALPR_SDK_PRINT_INFO("Startup: %s", startup.summary().c_str());
+	}
+	grabber.stop();
 	cap.release();
+	v4l2.close();
 	video.release();
+	recorder.close();
+	if (alertsLog) {
+		alertsLog->flush();
+	}
+	verifier.flush();
+	stopMPlayer();
+	previewServer.stop();
+	metricsServer.stop();
 	// DeInit
 		ULTALPR_SDK_PRINT_INFO("Ending recognizer...");
-		result = UltAlprSdkEngine::deInit();
+		result = engine->deInit();
     return 0;
 }
+
+static void printUsage(const std::string& message /*= ""*/)
+{
+	if (!message.empty()) {
+		ULTALPR_SDK_PRINT_ERROR("%s", message.c_str());
+	}
+
+	ULTALPR_SDK_PRINT_INFO(
+		"\n********************************************************************************\n"
+		"main <path-to-video> <display-scale-factor>\n"
+		"\t[--registered <path-to-watchlist>] \n"
+		"\t[--actions <path-to-json-actions>] \n"
+		"\t[--verify_mode <deny / allow>] \n"
+		"\t[--coverage_report <path-to-report>] [--coverage_interval <seconds>] \n"
+		"\t[--num_repeat <readings-to-confirm-a-plate:[1, inf]>] \n"
+		"\t[--alerts <path-to-alerts-log>] \n"
+		"\t[--record <path-to-recording>] \n"
+		"\t[--engine <sdk / mock>] \n"
+		"\t[--assets <path-to-assets-folder>] \n"
+		"\t[--backend <auto / cpu / openvino / tensorrt>] \n"
+		"\t[--openvino_device <openvino_device-to-use>] \n"
+		"\t[--mock_results <path-to-json-lines>] \n"
+		"\t[--mock_latency_ms <millis>] \n"
+		"\t[--metrics_port <port>] \n"
+		"\t[--stats_interval <seconds>] \n"
+		"\t[--headless <true / false>] \n"
+		"\t[--max_age_ms <millis>] \n"
+		"\t[--preview_port <port>] \n"
+		"\t[--preview_fps <fps>] \n"
+		"\t[--capture <auto / ffmpeg / gstreamer / v4l2 / v4l2_mmap>] \n"
+		"\t[--capture_threads <decoder-threads>] \n"
+		"\t[--capture_hwaccel <true / false>] \n"
+		"\t[--capture_fourcc <pixel-format>] \n"
+		"\t[--capture_buffers <count>] \n"
+		"\t[--capture_width <pixels>] [--capture_height <pixels>] [--capture_fps <fps>] \n"
+		"\t[--target_fps <fps>] \n"
+		"\t[--quality_tiers <path-to-json>] \n"
+		"\t[--overlap_startup <true / false>] \n"
+		"\t[--trt_check <strict / warn / off>] \n"
+		"\t[--trt_plugin <path-to-tensorrt-plugin>] \n"
+		"\t[--batch <true / false>] \n"
+		"\t[--batch_queue <frames>] \n"
+		"\t[--segments <workers>] \n"
+		"main --replay <path-to-recording> [--registered ...] [--actions ...] [--verify_mode ...] [--coverage_report ...] [--num_repeat ...] [--alerts ...]\n"
+		"\n"
+		"Options surrounded with [] are optional.\n"
+		"\n"
+		"--registered: Registered plates, separated by white spaces, each one optionally followed by \",category,priority\" (e.g. ABC1234,stolen,3), or a list compiled with the watchlist tool (mmap'ed). Must load when given, and must not be empty with --verify_mode allow. Default: ../registered.txt.\n\n"
+		"--actions: What a hit does, per watchlist category: JSON object of {\"sound\", \"colour\": [R, G, B], \"log_only\", \"cooldown_s\"} by category name, \"default\" for the others. Default: play ../sound/sound.mp3 and flash red.\n\n"
+		"--verify_mode: deny: alert when a confirmed plate is registered. allow: alert when a confirmed plate is NOT registered (with the default action). Default: deny.\n\n"
+		"--coverage_report: Write the registered plates never confirmed so far to this file, every --coverage_interval seconds (default: 3600) and at exit.\n\n"
+		"--num_repeat: Number of readings needed to confirm a plate. Default: 5.\n\n"
+		"--alerts: Write one line per alert to this file: frame index, millis since the first frame, plate and, for live runs, capture to decision latency in millis. Use the first 3 columns to compare a live run with replays.\n\n"
+		"--record: Save the result of every frame to this file so that it can be replayed with --replay.\n\n"
+		"--replay: Re-run the vote, the watchlist and the alerts on a recording made with --record, without video nor inference, as fast as possible.\n\n"
+		"--engine: Recognition backend. 'sdk' is ultimateALPR, 'mock' replays --mock_results and doesn't need the SDK. Default: sdk when built with the SDK, mock otherwise.\n\n"
+		"--assets: Path to the assets folder. Default: ../assets.\n\n"
+		"--backend: Inference backend. 'cpu': TensorFlow on the CPU, 'openvino': OpenVINO on --openvino_device (x86), 'tensorrt': TensorRT plans on the GPU (Jetson), 'auto': the SDK's choice with gpgpu_enabled. An openvino or tensorrt backend that can't run on this host is refused at startup. Compare them on a clip with the benchmark's 'backends' scenario. Default: auto.\n\n"
+		"--openvino_device: OpenVINO device (CPU, GPU, MYRIAD...) when --backend is openvino. Default: CPU.\n\n"
+		"--mock_results: JSON Lines file with the SDK result of each frame, replayed in a loop by the mock engine. No plate at all when not provided.\n\n"
+		"--mock_latency_ms: Synthetic processing time per frame for the mock engine. Default: 0.\n\n"
+		"--metrics_port: Serve per-stage latency histograms and counters in Prometheus text format at http://127.0.0.1:<port>/metrics.\n\n"
+		"--stats_interval: Print the metrics as one line on stderr every <seconds>. Default: 0 (never).\n\n"
+		"--headless: No window and no keyboard, stop with SIGINT/SIGTERM. Always true when built with -DALPR_HEADLESS=ON. Default: false.\n\n"
+		"--max_age_ms: Drop the frames older than this when they are about to go to the engine (counted in alpr_frames_dropped_total), so that latency can't pile up behind a slow frame. The age is measured from the driver's timestamp with v4l2_mmap. With the other backends the frames are read on a separate thread that keeps only the newest one (files are paced at their frame rate), the frames overwritten there are counted as dropped too and the age is measured from that read. Default: 0 (never drop, frames read when needed).\n\n"
+		"--preview_port: Serve a low frame rate MJPEG preview at http://127.0.0.1:<port>/preview.\n\n"
+		"--preview_fps: Frame rate of the preview, must be > 0. Default: 2.\n\n"
+		"--capture: Capture backend. 'auto' lets OpenCV pick, 'ffmpeg' and 'gstreamer' decode files and streams (<path-to-video> may be a GStreamer pipeline ending with an appsink), 'v4l2' opens a camera (/dev/videoN or its index) with mmap'ed buffers. 'v4l2_mmap' is the native V4L2 path (no OpenCV capture): the driver's NV12 buffers go to the engine without any copy, YUYV only needs the luma extracted. <path-to-video> is the device or a file with raw frames in --capture_fourcc format. Default: auto.\n\n"
+		"--capture_threads: FFmpeg decoder threads. Default: 0 (FFmpeg's choice).\n\n"
+		"--capture_hwaccel: FFmpeg hardware decoding when available, needs OpenCV 4.5.2+. Default: false.\n\n"
+		"--capture_fourcc: V4L2 pixel format, e.g. MJPG or YUYV. NV12 or YUYV with v4l2_mmap. Default: the driver's, YUYV with v4l2_mmap.\n\n"
+		"--capture_buffers: Number of V4L2 mmap'ed buffers. Default: the driver's.\n\n"
+		"--capture_width, --capture_height, --capture_fps: V4L2 capture size and frame rate. Default: the driver's, 1280x720 with v4l2_mmap.\n\n"
+		"--target_fps: Frame rate to hold by stepping between quality tiers (ROI crop, downscale, frame stride, all applied before process() without re-initializing the engine) depending on the per-frame time and on the frames queued in the driver. Every change is logged. Default: 0 (fixed quality).\n\n"
+		"--quality_tiers: JSON array of tiers from the best to the cheapest, e.g. [{\"name\": \"full\"}, {\"name\": \"fast\", \"roi\": 0.75, \"scale\": 0.5, \"stride\": 2}]. Default: full, roi, roi+downscale, roi+downscale+stride.\n\n"
+		"--overlap_startup: Open the capture and read its first frame on a separate thread while the engine loads its models and warms up. The startup timeline (init, warm_up, capture_open, first_frame, first_result, steady_state) is logged once the processing time is stable and exported as alpr_startup_seconds. Default: false.\n\n"
+		"--trt_check: Check the TensorRT plans in <assets>/models.tensorrt/optimized against the fingerprints recorded by trt_prepare before starting. 'strict' refuses to start when they are stale, 'warn' logs why. Only done with --backend tensorrt, or auto on a Jetson with <assets>/models.tensorrt. Default: warn.\n\n"
+		"--trt_plugin: TensorRT plugin loaded by the SDK, part of the fingerprints. Default: ../lib/libultimatePluginTensorRT.so.\n\n"
+		"--batch: Offline processing of a recorded video as fast as possible: frames are decoded ahead on another thread, the engine runs in parallel mode and there is no display, no sound and no output video. Alerts go to --alerts or stdout, the achieved fps is printed at the end. Default: false.\n\n"
+		"--batch_queue: Maximum number of frames decoded ahead in --batch mode. Default: 16.\n\n"
+		"--segments: Split the video in this many segments in --batch mode, each one decoded and recognized by its own process. 0 means one per core. Lower num_threads in the config when using several segments. Default: 1.\n\n"
+		"********************************************************************************\n"
+	);
+}
+
+/*
+* Votes for the plates of one frame, alerts go to 'alertsLog' or stdout. Returns the number of alerts.
+*/
+static size_t decide(AlprPlateVoter& voter, AlprVerifier& verifier, AlprActionTable& actions, std::ostream* alertsLog, const uint32_t frame, const uint64_t timestampMicros, const std::string& json)
+{
+	size_t numAlerts = 0;
+	AlprWatchlistEntry entry;
+	for (const AlprPlate& plate : alprParsePlates(json)) {
+		if (voter.vote(plate.text) && verifier.check(plate.text, entry) && actions.admit(plate.text, actions.action(entry.category), timestampMicros)) {
+			++numAlerts;
+			if (alertsLog) {
+				*alertsLog << frame << "\t" << timestampMicros / 1000 << "\t" << plate.text << "\n";
+			}
+			else {
+				std::cout << frame << "\t" << timestampMicros / 1000 << "\t" << plate.text << std::endl;
+			}
+		}
+	}
+	return numAlerts;
+}
+
+/*
+* Feeds a recording to the decision logic, as fast as possible
+*/
+static int replay(const std::string& path, AlprPlateVoter& voter, AlprVerifier& verifier, AlprActionTable& actions, std::ostream* alertsLog)
+{
+	AlprRecordReader reader;
+	if (!reader.open(path)) {
+		return -1;
+	}
+	const AlprClock::time_point start = AlprClock::now();
+	AlprRecordEntry entry;
+	uint32_t numFrames = 0;
+	size_t numAlerts = 0;
+	while (reader.next(entry)) {
+		// Frames without plates are not recorded but still count for the vote refresh
+		for (; numFrames <= entry.frame; ++numFrames) {
+			voter.nextFrame();
+		}
+		if (entry.json.empty()) {
+			numFrames = entry.frame; // end marker
+			break;
+		}
+		numAlerts += decide(voter, verifier, actions, alertsLog, entry.frame, entry.timestampMicros, entry.json);
+	}
+	verifier.flush();
+	const double seconds = alprMicrosSince(start) * 1e-6;
+	ULTALPR_SDK_PRINT_INFO("Replayed %u frames in %.3lf seconds (%.0lf fps), %zu alerts", numFrames, seconds, seconds > 0 ? numFrames / seconds : 0.0, numAlerts);
+	return 0;
+}
+
+/*
+* Results delivered by the engine in parallel mode, indexed by frame
+*/
+class BatchCollector : public AlprEngineCallback {
+public:
+	virtual void onNewResult(const AlprEngineResult& result) override {
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		if (result.frameId < 0) {
+			++m_nUnattributed;
+			return;
+		}
+		m_Jsons[static_cast<uint32_t>(result.frameId)] = result.json;
+	}
+	// Only safe once the engine is stopped
+	std::map<uint32_t, std::string>& jsons() { return m_Jsons; }
+	size_t unattributed() const { return m_nUnattributed; }
+
+private:
+	std::mutex m_Mutex;
+	std::map<uint32_t, std::string> m_Jsons;
+	size_t m_nUnattributed = 0;
+};
+
+struct BatchFrame {
+	uint32_t index = 0;
+	uint64_t timestampMicros = 0; // position in the video
+	cv::Mat image;
+};
+
+/*
+* Outcome of a batch run: the frames with plates, keyed by frame index in the whole video
+*/
+struct BatchSightings {
+	uint32_t numFrames = 0;
+	uint64_t endTimestampMicros = 0;
+	std::map<uint32_t, AlprRecordEntry> entries;
+};
+
+/*
+* Runs the engine over the frames [begin, end) of a video. A decoder thread keeps up to 'queueDepth'
+* frames ahead of the engine, which runs in parallel mode so that the next frame is submitted while
+* the previous ones are still being recognized.
+*/
+static bool batchRun(const std::string& videoPath, const AlprCaptureOptions& capture, AlprEngine& engine, const std::string& jsonConfig, const size_t queueDepth,
+	const uint32_t begin, const uint32_t end, BatchSightings& sightings)
+{
+	BatchCollector collector;
+	AlprEngineResult result = alprEngineInitWarm(engine, jsonConfig, ULTALPR_SDK_IMAGE_TYPE_BGR24, &collector);
+	if (!result.isOK()) {
+		ULTALPR_SDK_PRINT_ERROR("Failed to initialize the engine: %s", result.phrase.c_str());
+		return false;
+	}
+	cv::VideoCapture cap;
+	if (!alprCaptureOpen(cap, videoPath, capture)) {
+		engine.deInit();
+		return false;
+	}
+	if (begin > 0) {
+		cap.set(cv::CAP_PROP_POS_FRAMES, begin); // FFmpeg seeks to the previous keyframe and decodes up to 'begin'
+	}
+	const double totalFrames = std::min<double>(cap.get(cv::CAP_PROP_FRAME_COUNT), end) - begin;
+
+	const AlprClock::time_point start = AlprClock::now();
+	AlprBoundedQueue<BatchFrame> queue(queueDepth);
+	std::thread decoder([&cap, &queue, begin, end]() {
+		for (uint32_t index = 0; index < end - begin && !stopRequested; ++index) {
+			BatchFrame frame;
+			if (!cap.read(frame.image) || frame.image.empty()) {
+				break;
+			}
+			frame.index = index;
+			frame.timestampMicros = static_cast<uint64_t>(cap.get(cv::CAP_PROP_POS_MSEC) * 1000.0);
+			if (!queue.push(std::move(frame))) {
+				break;
+			}
+		}
+		queue.close();
+	});
+
+	std::vector<uint64_t> timestamps;
+	uint64_t waitMicros = 0, processMicros = 0;
+	AlprClock::time_point lastProgress = start;
+	BatchFrame frame;
+	while (true) {
+		AlprClock::time_point stageStart = AlprClock::now();
+		if (!queue.pop(frame)) {
+			break;
+		}
+		waitMicros += alprMicrosSince(stageStart);
+		stageStart = AlprClock::now();
+		result = engine.process(
+			ULTALPR_SDK_IMAGE_TYPE_BGR24,
+			frame.image.data,
+			frame.image.cols,
+			frame.image.rows,
+			frame.image.step / frame.image.elemSize()
+		);
+		processMicros += alprMicrosSince(stageStart);
+		if (!result.isOK()) {
+			ULTALPR_SDK_PRINT_ERROR("Frame %u: %s", begin + frame.index, result.phrase.c_str());
+		}
+		else if (result.numPlates) { // backends without parallel delivery
+			result.frameId = frame.index;
+			collector.onNewResult(result);
+		}
+		timestamps.push_back(frame.timestampMicros);
+		if (alprMicrosSince(lastProgress) >= 10000000) {
+			lastProgress = AlprClock::now();
+			const double seconds = alprMicrosSince(start) * 1e-6;
+			ULTALPR_SDK_PRINT_INFO("[%u] %zu/%.0lf frames (%.1lf fps)", begin, timestamps.size(), totalFrames, timestamps.size() / seconds);
+		}
+	}
+	queue.close(); // unblocks the decoder when stopped early
+	decoder.join();
+	cap.release();
+	engine.deInit(); // waits for the results still in flight
+	const double seconds = alprMicrosSince(start) * 1e-6;
+	if (collector.unattributed()) {
+		ULTALPR_SDK_PRINT_WARN("%zu results without frame index were ignored", collector.unattributed());
+	}
+	ULTALPR_SDK_PRINT_INFO("[%u] %zu frames in %.3lf seconds (%.1lf fps), waiting for the decoder: %.1lf%%, submitting to the engine: %.1lf%%",
+		begin, timestamps.size(), seconds, seconds > 0 ? timestamps.size() / seconds : 0.0,
+		seconds > 0 ? waitMicros * 1e-4 / seconds : 0.0, seconds > 0 ? processMicros * 1e-4 / seconds : 0.0);
+
+	for (std::map<uint32_t, std::string>::iterator it = collector.jsons().begin(); it != collector.jsons().end(); ++it) {
+		if (it->first < timestamps.size()) {
+			AlprRecordEntry& entry = sightings.entries[begin + it->first];
+			entry.frame = begin + it->first;
+			entry.timestampMicros = timestamps[it->first];
+			entry.json.swap(it->second);
+		}
+	}
+	sightings.numFrames = begin + static_cast<uint32_t>(timestamps.size());
+	sightings.endTimestampMicros = timestamps.empty() ? 0 : timestamps.back();
+	return true;
+}
+
+/*
+* Splits the video in 'numSegments' contiguous segments, each one processed by its own process with
+* its own decoder and engine (the SDK engine is a process-wide singleton, the model files are shared
+* through the page cache). Every worker writes its sightings to a recording (alpr_record.h), the
+* parent merges them back with the frame indices and timestamps of the whole video.
+*/
+static bool batchSplit(const std::string& videoPath, const AlprCaptureOptions& capture, AlprEngine& engine, const std::string& jsonConfig, const size_t queueDepth,
+	const int numSegments, BatchSightings& sightings)
+{
+	cv::VideoCapture probe;
+	const double totalFrames = alprCaptureOpen(probe, videoPath, capture) ? probe.get(cv::CAP_PROP_FRAME_COUNT) : 0.0;
+	probe.release();
+	if (totalFrames < numSegments) {
+		ULTALPR_SDK_PRINT_WARN("Unknown or too small frame count (%.0lf), not splitting", totalFrames);
+		return batchRun(videoPath, capture, engine, jsonConfig, queueDepth, 0, UINT32_MAX, sightings);
+	}
+
+	// The recordings go to a private directory (mkdtemp, mode 0700): predictable names in /tmp could be pre-created or linked by another user
+	char segmentsDir[] = "/tmp/alpr-segments-XXXXXX";
+	if (!mkdtemp(segmentsDir)) {
+		ULTALPR_SDK_PRINT_ERROR("Failed to create %s: %s", segmentsDir, strerror(errno));
+		return false;
+	}
+	std::vector<uint32_t> bounds;
+	std::vector<std::string> paths;
+	std::vector<pid_t> workers;
+	for (int i = 0; i < numSegments; ++i) {
+		bounds.push_back(static_cast<uint32_t>(totalFrames * i / numSegments));
+		paths.push_back(std::string(segmentsDir) + "/segment-" + std::to_string(i) + ".rec");
+	}
+	bounds.push_back(UINT32_MAX); // the frame count in the container is not always exact
+	for (int i = 0; i < numSegments; ++i) {
+		const pid_t pid = fork();
+		if (pid == 0) {
+			// Worker: _exit() so that nothing owned by the parent (threads, buffered streams) is touched
+			BatchSightings segment;
+			AlprRecordWriter writer;
+			if (!writer.open(paths[i]) || !batchRun(videoPath, capture, engine, jsonConfig, queueDepth, bounds[i], bounds[i + 1], segment)) {
+				_exit(1);
+			}
+			for (uint32_t index = bounds[i]; index < segment.numFrames; ++index) {
+				const std::map<uint32_t, AlprRecordEntry>::const_iterator it = segment.entries.find(index);
+				writer.write(it != segment.entries.end() ? it->second.timestampMicros : segment.endTimestampMicros,
+					it != segment.entries.end() ? it->second.json : std::string());
+			}
+			writer.close();
+			_exit(0);
+		}
+		if (pid < 0) {
+			ULTALPR_SDK_PRINT_ERROR("Failed to start worker %d", i);
+			break;
+		}
+		workers.push_back(pid);
+	}
+
+	bool ok = workers.size() == static_cast<size_t>(numSegments);
+	for (size_t i = 0; i < workers.size(); ++i) {
+		int status = 0;
+		while (waitpid(workers[i], &status, 0) < 0 && errno == EINTR) {
+			if (stopRequested) {
+				kill(workers[i], SIGTERM); // forward, the worker drains its segment
+			}
+		}
+		if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+			ULTALPR_SDK_PRINT_ERROR("Worker %zu failed", i);
+			ok = false;
+		}
+	}
+
+	// Merge: recorded frame indices are relative to the segment
+	for (size_t i = 0; ok && i < workers.size(); ++i) {
+		AlprRecordReader reader;
+		AlprRecordEntry entry;
+		if (!reader.open(paths[i])) {
+			ok = false;
+			break;
+		}
+		while (reader.next(entry)) {
+			if (entry.json.empty()) {
+				if (i + 1 < workers.size() && bounds[i] + entry.frame != bounds[i + 1]) {
+					ULTALPR_SDK_PRINT_WARN("Segment %zu decoded %u frames instead of %u", i, entry.frame, bounds[i + 1] - bounds[i]);
+				}
+				sightings.numFrames = bounds[i] + entry.frame;
+				sightings.endTimestampMicros = entry.timestampMicros;
+				break;
+			}
+			entry.frame += bounds[i];
+			sightings.entries[entry.frame] = entry;
+		}
+	}
+	for (size_t i = 0; i < paths.size(); ++i) {
+		unlink(paths[i].c_str());
+	}
+	rmdir(segmentsDir);
+	return ok;
+}
+
+/*
+* Offline processing of a recorded video, see batchRun() and batchSplit(). The decision logic runs
+* once all the results are in, over the whole video and in frame order: the vote windows span the
+* segment boundaries and the alerts are the same as a live run over the same results.
+*/
+static int batch(const std::string& videoPath, const AlprCaptureOptions& capture, AlprEngine& engine, const std::string& jsonConfig, const size_t queueDepth, const int numSegments,
+	AlprPlateVoter& voter, AlprVerifier& verifier, AlprActionTable& actions, std::ostream* alertsLog, AlprRecordWriter& recorder)
+{
+	ULTALPR_SDK_PRINT_INFO("Starting recognizer (%s, parallel, %d segment(s))...", engine.name(), numSegments);
+	const AlprClock::time_point start = AlprClock::now();
+	BatchSightings sightings;
+	const bool ok = (numSegments > 1)
+		? batchSplit(videoPath, capture, engine, jsonConfig, queueDepth, numSegments, sightings)
+		: batchRun(videoPath, capture, engine, jsonConfig, queueDepth, 0, UINT32_MAX, sightings);
+	if (!ok) {
+		return -1;
+	}
+	const double seconds = alprMicrosSince(start) * 1e-6;
+
+	// Decision logic, in frame order
+	size_t numAlerts = 0;
+	uint64_t timestampMicros = 0;
+	for (uint32_t index = 0; index < sightings.numFrames; ++index) {
+		voter.nextFrame();
+		const std::map<uint32_t, AlprRecordEntry>::const_iterator it = sightings.entries.find(index);
+		if (it == sightings.entries.end()) {
+			recorder.write(index + 1 < sightings.numFrames ? timestampMicros : sightings.endTimestampMicros, std::string());
+			continue;
+		}
+		timestampMicros = it->second.timestampMicros;
+		recorder.write(timestampMicros, it->second.json);
+		numAlerts += decide(voter, verifier, actions, alertsLog, index, timestampMicros, it->second.json);
+	}
+	recorder.close();
+	if (alertsLog) {
+		alertsLog->flush();
+	}
+	verifier.flush();
+
+	ULTALPR_SDK_PRINT_INFO("Processed %u frames in %.3lf seconds (%.1lf fps), %zu alerts%s", sightings.numFrames, seconds,
+		seconds > 0 ? sightings.numFrames / seconds : 0.0, numAlerts, stopRequested ? " (stopped early)" : "");
+	return 0;
+}
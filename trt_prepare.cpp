@@ -0,0 +1,72 @@
+#include <ultimateALPR-SDK-API-PUBLIC.h>
+#include <alpr_utils.h>
+#include <alpr_trt.h>
+#include <map>
+#include <string>
+#include <vector>
+
+/*
+* Builds the TensorRT plans of a Jetson deployment and records their fingerprints, see alpr_trt.h
+*	trt_prepare [--assets ../assets] [--plugin ../lib/libultimatePluginTensorRT.so] [--force true] [--check true]
+* Replaces running lib/trt_optimizer by hand: the plans are only rebuilt when the manifest says they are stale
+* (or with --force), so it can run on every deployment. "make trt_plans" runs it from the build folder.
+* --check only compares and exits with 1 when the plans are stale.
+*/
+
+static void printUsage(const std::string& message = "")
+{
+	if (!message.empty()) {
+		ULTALPR_SDK_PRINT_ERROR("%s", message.c_str());
+	}
+	ULTALPR_SDK_PRINT_INFO(
+		"\n********************************************************************************\n"
+		"trt_prepare\n"
+		"\t[--assets <path-to-assets-folder>] \n"
+		"\t[--plugin <path-to-tensorrt-plugin>] \n"
+		"\t[--force <true|false>] \n"
+		"\t[--check <true|false>] \n"
+		"\n"
+		"Options surrounded with [] are optional.\n"
+		"\n"
+		"--assets: Path to the assets folder, the plans are written in <assets>/models.tensorrt/optimized (needs write permissions). Default: ../assets.\n\n"
+		"--plugin: TensorRT plugin loaded by the SDK, part of the fingerprints. Default: ../lib/libultimatePluginTensorRT.so.\n\n"
+		"--force: Rebuild the plans even when they are up to date. Default: false.\n\n"
+		"--check: Only check the plans against their manifest, exit code 1 when they are stale. Default: false.\n\n"
+		"********************************************************************************\n"
+	);
+}
+
+int main(int argc, char *argv[])
+{
+	std::map<std::string, std::string > args;
+	if (!alprParseArgs(argc, argv, args)) {
+		printUsage();
+		return -1;
+	}
+	const std::string assetsFolder = (args.find("--assets") != args.end()) ? args["--assets"] : "../assets";
+	const std::string pluginPath = (args.find("--plugin") != args.end()) ? args["--plugin"] : "../lib/libultimatePluginTensorRT.so";
+	const bool force = (args.find("--force") != args.end()) && (args["--force"].compare("true") == 0);
+	const bool checkOnly = (args.find("--check") != args.end()) && (args["--check"].compare("true") == 0);
+
+	std::vector<std::string> problems;
+	const bool upToDate = alprTrtCheck(assetsFolder, pluginPath, problems);
+	for (const std::string& problem : problems) {
+		ULTALPR_SDK_PRINT_WARN("TensorRT plans: %s", problem.c_str());
+	}
+	if (checkOnly) {
+		ULTALPR_SDK_PRINT_INFO("TensorRT plans %s", upToDate ? "up to date" : "stale");
+		return upToDate ? 0 : 1;
+	}
+	if (upToDate && !force) {
+		ULTALPR_SDK_PRINT_INFO("TensorRT plans up to date, nothing to do");
+		return 0;
+	}
+
+	ULTALPR_SDK_PRINT_INFO("Building the TensorRT plans in %s/models.tensorrt/optimized, this takes several minutes...", assetsFolder.c_str());
+	const UltAlprSdkResult result = UltAlprSdkEngine::optimizeTRT(assetsFolder.c_str());
+	if (!result.isOK()) {
+		ULTALPR_SDK_PRINT_ERROR("optimizeTRT failed: %s", result.phrase());
+		return -1;
+	}
+	return alprTrtRecord(assetsFolder, pluginPath) ? 0 : -1;
+}
@@ -0,0 +1,347 @@
+#include <ultimateALPR-SDK-API-PUBLIC.h>
+#include <alpr_utils.h>
+#include <alpr_watchlist.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <queue>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+/*
+* Watchlist management, for the registered.txt family of lists
+*	watchlist compile <input> <output.bin> [--perfect_hash true]
+*	watchlist merge <output> <input> [<input>...]
+*	watchlist sort <output> <input> (also "dedupe")
+*	watchlist diff <output> <first> <second>
+* Inputs are text lists (see alpr_watchlist.h), in any order. They are sorted externally: chunks of at most
+* --memory_mb are sorted in memory and spilled to --tmp_dir, then the chunks are merged, so the lists
+* may be bigger than RAM. Outputs ending with ".bin" are compiled (the form main mmaps), the others are text.
+*/
+
+static void printUsage(const std::string& message = "")
+{
+	if (!message.empty()) {
+		ULTALPR_SDK_PRINT_ERROR("%s", message.c_str());
+	}
+	ULTALPR_SDK_PRINT_INFO(
+		"\n********************************************************************************\n"
+		"watchlist compile <input> <output.bin> [--perfect_hash <true|false>]\n"
+		"watchlist merge <output> <input> [<input>...]\n"
+		"watchlist sort <output> <input>\n"
+		"watchlist dedupe <output> <input>\n"
+		"watchlist diff <output> <first> <second>\n"
+		"\t[--perfect_hash <true|false>] \n"
+		"\t[--memory_mb <megabytes>] \n"
+		"\t[--tmp_dir <path>] \n"
+		"\n"
+		"Options surrounded with [] are optional.\n"
+		"\n"
+		"Inputs are text watchlists: \"PLATE[,CATEGORY[,PRIORITY]]\" separated by white spaces. Plates are normalized. "
+		"A plate listed several times keeps its highest priority.\n\n"
+		"compile: Turns a text watchlist into a sorted, packed binary file that main loads with mmap (--registered).\n\n"
+		"merge: Union of the inputs, sorted, each plate once.\n\n"
+		"sort, dedupe: The input sorted, each plate once.\n\n"
+		"diff: Plates only in <first> (\"-PLATE\") and only in <second> (\"+PLATE\"), sorted. The counts are printed.\n\n"
+		"<output>: Compiled when it ends with .bin (not for diff), text otherwise.\n\n"
+		"--perfect_hash: Adds a perfect hash table to a compiled output, lookups are then O(1) instead of a binary search. Default: false.\n\n"
+		"--memory_mb: Memory used to sort, bigger inputs are sorted in several chunks spilled to disk. Default: 256.\n\n"
+		"--tmp_dir: Where the chunks are spilled. Default: /tmp.\n\n"
+		"********************************************************************************\n"
+	);
+}
+
+/*
+* Entry of a sorted chunk: the record and the index of the input it comes from
+*/
+struct SortEntry {
+	AlprWatchlistRecord record;
+	size_t input = 0;
+};
+
+static inline bool sortBefore(const SortEntry& a, const SortEntry& b)
+{
+	const int compare = a.record.plate.compare(b.record.plate);
+	return compare < 0 || (compare == 0 && (a.record.priority > b.record.priority || (a.record.priority == b.record.priority && a.input < b.input)));
+}
+
+/*
+* Sorted chunk, in memory (the last one) or spilled to a file ("plate \t category \t priority \t input" lines)
+*/
+class SortRun {
+public:
+	SortRun(std::vector<SortEntry>* entries) : m_pEntries(entries), m_nNext(0) {}
+	SortRun(const std::string& path) : m_pEntries(nullptr), m_nNext(0), m_File(path.c_str()) {}
+
+	bool next(SortEntry& entry) {
+		if (m_pEntries) {
+			if (m_nNext >= m_pEntries->size()) {
+				return false;
+			}
+			entry = (*m_pEntries)[m_nNext++];
+			return true;
+		}
+		std::string line;
+		if (!std::getline(m_File, line)) {
+			return false;
+		}
+		const size_t tab1 = line.find('\t'), tab2 = line.find('\t', tab1 + 1), tab3 = line.find('\t', tab2 + 1);
+		if (tab3 == std::string::npos) {
+			return false;
+		}
+		entry.record.plate = line.substr(0, tab1);
+		entry.record.category = line.substr(tab1 + 1, tab2 - tab1 - 1);
+		entry.record.priority = std::atoi(line.c_str() + tab2 + 1);
+		entry.input = static_cast<size_t>(std::atol(line.c_str() + tab3 + 1));
+		return true;
+	}
+
+private:
+	std::vector<SortEntry>* m_pEntries;
+	size_t m_nNext;
+	std::ifstream m_File;
+};
+
+/*
+* Streams the plates of all the inputs in sorted order, each plate once: 'visit' receives the record with the
+* highest priority and a mask of the inputs the plate is in (bit i for inputs[i], up to 64 inputs).
+*/
+static bool forEachSorted(const std::vector<std::string>& inputs, const size_t memoryBytes, const std::string& tmpDir,
+	const std::function<bool(const AlprWatchlistRecord&, uint64_t)>& visit)
+{
+	if (inputs.size() > 64) {
+		ULTALPR_SDK_PRINT_ERROR("At most 64 inputs");
+		return false;
+	}
+	// 1. Sorted chunks
+	std::vector<SortEntry> chunk;
+	std::vector<std::string> spilled;
+	size_t chunkBytes = 0, numRecords = 0;
+	const auto spill = [&]() {
+		std::stable_sort(chunk.begin(), chunk.end(), sortBefore);
+		// mkstemp: created with a unique name and mode 0600, never a file or link already in a shared --tmp_dir
+		std::vector<char> name(tmpDir.begin(), tmpDir.end());
+		const std::string suffix = "/alpr-watchlist-XXXXXX";
+		name.insert(name.end(), suffix.begin(), suffix.end());
+		name.push_back('\0');
+		const int fd = mkstemp(name.data());
+		if (fd < 0) {
+			return false;
+		}
+		close(fd);
+		const std::string path(name.data());
+		spilled.push_back(path);
+		std::ofstream run(path.c_str(), std::ios::trunc);
+		for (const SortEntry& entry : chunk) {
+			run << entry.record.plate << '\t' << entry.record.category << '\t' << entry.record.priority << '\t' << entry.input << '\n';
+		}
+		run.close();
+		chunk.clear();
+		chunkBytes = 0;
+		return static_cast<bool>(run);
+	};
+	const auto cleanup = [&spilled]() {
+		for (const std::string& path : spilled) {
+			std::remove(path.c_str());
+		}
+	};
+	for (size_t i = 0; i < inputs.size(); ++i) {
+		std::ifstream input(inputs[i].c_str());
+		if (!input) {
+			ULTALPR_SDK_PRINT_ERROR("Failed to open %s", inputs[i].c_str());
+			cleanup();
+			return false;
+		}
+		std::string buff;
+		SortEntry entry;
+		entry.input = i;
+		while (input >> buff) {
+			if (!alprWatchlistParseRecord(buff, entry.record)) {
+				ULTALPR_SDK_PRINT_WARN("%s: invalid entry '%s'", inputs[i].c_str(), buff.c_str());
+				continue;
+			}
+			chunk.push_back(entry);
+			++numRecords;
+			chunkBytes += sizeof(SortEntry) + entry.record.plate.capacity() + entry.record.category.capacity();
+			if (chunkBytes >= memoryBytes && !spill()) {
+				ULTALPR_SDK_PRINT_ERROR("Failed to spill a sorted chunk to %s", tmpDir.c_str());
+				cleanup();
+				return false;
+			}
+		}
+	}
+	std::stable_sort(chunk.begin(), chunk.end(), sortBefore);
+	if (!spilled.empty()) {
+		ULTALPR_SDK_PRINT_INFO("%zu entries sorted in %zu chunks", numRecords, spilled.size() + 1);
+	}
+
+	// 2. K-way merge of the chunks, the first entry of each plate has the highest priority
+	std::vector<std::unique_ptr<SortRun> > runs;
+	for (const std::string& path : spilled) {
+		runs.push_back(std::unique_ptr<SortRun>(new SortRun(path)));
+	}
+	runs.push_back(std::unique_ptr<SortRun>(new SortRun(&chunk)));
+	typedef std::pair<SortEntry, size_t> Head; // entry, run
+	const auto after = [](const Head& a, const Head& b) { return sortBefore(b.first, a.first) || (!sortBefore(a.first, b.first) && a.second > b.second); };
+	std::priority_queue<Head, std::vector<Head>, decltype(after)> heads(after);
+	for (size_t r = 0; r < runs.size(); ++r) {
+		Head head;
+		head.second = r;
+		if (runs[r]->next(head.first)) {
+			heads.push(head);
+		}
+	}
+	bool ok = true;
+	AlprWatchlistRecord best;
+	uint64_t mask = 0;
+	while (!heads.empty() && ok) {
+		Head head = heads.top();
+		heads.pop();
+		if (mask && head.first.record.plate != best.plate) {
+			ok = visit(best, mask);
+			mask = 0;
+		}
+		if (!mask) {
+			best = head.first.record;
+		}
+		mask |= (1ULL << head.first.input);
+		if (runs[head.second]->next(head.first)) {
+			heads.push(head);
+		}
+	}
+	if (ok && mask) {
+		ok = visit(best, mask);
+	}
+	runs.clear();
+	cleanup();
+	return ok;
+}
+
+/*
+* Text output, written next to the destination then renamed
+*/
+class TextOutput {
+public:
+	bool open(const std::string& path) {
+		m_strPath = path;
+		m_File.open((path + ".tmp").c_str(), std::ios::trunc);
+		if (!m_File) {
+			ULTALPR_SDK_PRINT_ERROR("Failed to create %s.tmp", path.c_str());
+		}
+		return static_cast<bool>(m_File);
+	}
+	void write(const std::string& prefix, const AlprWatchlistRecord& record) {
+		m_File << prefix << record.plate;
+		if (!record.category.empty() || record.priority) {
+			m_File << ',' << record.category;
+			if (record.priority) {
+				m_File << ',' << record.priority;
+			}
+		}
+		m_File << '\n';
+	}
+	bool close() {
+		m_File.close();
+		if (!m_File || std::rename((m_strPath + ".tmp").c_str(), m_strPath.c_str()) != 0) {
+			ULTALPR_SDK_PRINT_ERROR("Failed to write %s", m_strPath.c_str());
+			std::remove((m_strPath + ".tmp").c_str());
+			return false;
+		}
+		return true;
+	}
+
+private:
+	std::string m_strPath;
+	std::ofstream m_File;
+};
+
+int main(int argc, char** argv) {
+	if (argc < 4) {
+		printUsage();
+		return -1;
+	}
+	const std::string command = argv[1];
+	int numPositionals = 2;
+	while (numPositionals < argc && strncmp(argv[numPositionals], "--", 2) != 0) {
+		++numPositionals;
+	}
+	std::vector<std::string> positionals(argv + 2, argv + numPositionals);
+	std::map<std::string, std::string > args;
+	if (!alprParseArgs(argc - numPositionals + 1, argv + numPositionals - 1, args)) {
+		printUsage();
+		return -1;
+	}
+	const bool perfectHash = (args.find("--perfect_hash") != args.end()) && (args["--perfect_hash"].compare("true") == 0);
+	const size_t memoryBytes = std::max<size_t>(1, static_cast<size_t>((args.find("--memory_mb") != args.end()) ? std::atoi(args["--memory_mb"].c_str()) : 256)) << 20;
+	const std::string tmpDir = (args.find("--tmp_dir") != args.end()) ? args["--tmp_dir"] : "/tmp";
+
+	std::string output;
+	std::vector<std::string> inputs;
+	if (command == "compile" && positionals.size() == 2) {
+		inputs.push_back(positionals[0]);
+		output = positionals[1];
+	}
+	else if ((command == "merge" && positionals.size() >= 2) || ((command == "sort" || command == "dedupe") && positionals.size() == 2)
+		|| (command == "diff" && positionals.size() == 3)) {
+		output = positionals[0];
+		inputs.assign(positionals.begin() + 1, positionals.end());
+	}
+	else {
+		printUsage("Unknown command or wrong number of paths");
+		return -1;
+	}
+	const bool binary = (command == "compile") || (output.size() > 4 && output.compare(output.size() - 4, 4, ".bin") == 0);
+
+	if (command == "diff") {
+		TextOutput text;
+		size_t numFirstOnly = 0, numSecondOnly = 0, numBoth = 0;
+		if (!text.open(output) || !forEachSorted(inputs, memoryBytes, tmpDir, [&](const AlprWatchlistRecord& record, const uint64_t mask) {
+			if (mask == 1) {
+				text.write("-", record);
+				++numFirstOnly;
+			}
+			else if (mask == 2) {
+				text.write("+", record);
+				++numSecondOnly;
+			}
+			else {
+				++numBoth;
+			}
+			return true;
+		}) || !text.close()) {
+			return -1;
+		}
+		ULTALPR_SDK_PRINT_INFO("%zu plates only in %s, %zu only in %s, %zu in both", numFirstOnly, inputs[0].c_str(), numSecondOnly, inputs[1].c_str(), numBoth);
+		return 0;
+	}
+
+	size_t numPlates = 0;
+	if (binary) {
+		AlprWatchlistCompiler compiler;
+		if (!forEachSorted(inputs, memoryBytes, tmpDir, [&](const AlprWatchlistRecord& record, const uint64_t) {
+			++numPlates;
+			return compiler.add(record);
+		}) || !compiler.write(output, perfectHash)) {
+			return -1;
+		}
+	}
+	else {
+		TextOutput text;
+		if (!text.open(output) || !forEachSorted(inputs, memoryBytes, tmpDir, [&](const AlprWatchlistRecord& record, const uint64_t) {
+			++numPlates;
+			text.write("", record);
+			return true;
+		}) || !text.close()) {
+			return -1;
+		}
+		ULTALPR_SDK_PRINT_INFO("%s: %zu plates", output.c_str(), numPlates);
+	}
+	return 0;
+}